@@ -0,0 +1,84 @@
+#include "arena-suite.h"
+#include "frame-arena.h"
+#include "box-tracker.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+bool check(bool passed, const char *name)
+{
+	printf("%-44s %s\n", name, passed ? "ok" : "FAILED");
+	return passed;
+}
+
+// A frame with text, so the tracker keeps its boxes
+cv::Mat make_text_frame()
+{
+	cv::Mat frame(360, 640, CV_8UC1, cv::Scalar(0));
+	cv::putText(frame, "Arena 0123", cv::Point(40, 120), cv::FONT_HERSHEY_DUPLEX, 2.0,
+		    cv::Scalar(255), 3);
+	return frame;
+}
+
+} // namespace
+
+int run_arena_verification()
+{
+	bool passed = true;
+	cv::MatAllocator *const opencv_default = cv::Mat::getDefaultAllocator();
+
+	{
+		frame_arena arena;
+		std::thread([&arena, &passed] {
+			frame_arena_scope scope(arena);
+			{
+				cv::Mat first(480, 640, CV_8UC4);
+			}
+			arena.end_iteration();
+			{
+				cv::Mat second(480, 640, CV_8UC4);
+			}
+			passed &= check(arena.reused() == 1, "released buffer reused");
+			arena.end_iteration();
+			arena.end_iteration();
+			passed &= check(arena.pooled_bytes() == 0, "unused buffer freed");
+		}).join();
+	}
+
+	// the filter teardown: the OCR thread allocated the tracker's patches and previous
+	// frame from the arena, and the arena is destroyed before the tracker releases them
+	const uint64_t detached_before = frame_arena::detached_pools();
+	auto arena = std::make_unique<frame_arena>();
+	box_tracker tracker;
+	std::thread([&arena, &tracker] {
+		frame_arena_scope scope(*arena);
+		const cv::Mat frame = make_text_frame();
+		std::vector<OCRBox> boxes = {{"Arena", cv::Rect(30, 60, 300, 80)}};
+		tracker.reset(frame, boxes);
+	}).join();
+	passed &= check(!tracker.empty() && arena->in_use_bytes() > 0,
+			"tracker holds arena buffers");
+	arena.reset();
+	passed &= check(frame_arena::detached_pools() == detached_before + 1,
+			"pool kept while its buffers are in use");
+	tracker.clear();
+	passed &= check(frame_arena::detached_pools() == detached_before,
+			"pool freed with its last buffer");
+
+	// as on module unload
+	frame_arena_restore_default_allocator();
+	passed &= check(cv::Mat::getDefaultAllocator() == opencv_default,
+			"default allocator restored");
+	cv::Mat after(16, 16, CV_8UC1);
+	passed &= check(after.u != nullptr && after.u->currAllocator == opencv_default,
+			"allocations bypass the plugin after restore");
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+#ifndef ARENA_SUITE_H
+#define ARENA_SUITE_H
+
+/**
+  * @brief Check the buffer recycling of frame_arena and its teardown.
+  *
+  * Buffers released in one iteration must be reused in the next and freed once unused for an
+  * iteration. Buffers still held when the arena is destroyed, e.g. the patches of a box
+  * tracker destroyed after the arena of its filter, must be freed when they are released
+  * without touching the destroyed arena. Run under AddressSanitizer to catch the latter.
+  * Last, frame_arena_restore_default_allocator must give OpenCV back its own allocator, as when
+  * the module unloads.
+  *
+  * @return 0, or 1 if a check fails
+*/
+int run_arena_verification();
+
+#endif /* ARENA_SUITE_H */
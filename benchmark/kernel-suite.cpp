@@ -0,0 +1,322 @@
+#include "kernel-suite.h"
+#include "simd-kernels.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+namespace {
+
+const cv::Size SOURCE_SIZES[] = {{1280, 720}, {1920, 1080}, {3840, 2160}};
+const int ITERATIONS = 50;
+// off, fixed, adaptive mean, adaptive gaussian, triangle, Otsu
+const int BINARIZATION_MODE_COUNT = 6;
+
+// A frame with text and noise, so the conversion does not run on uniform memory
+cv::Mat make_source_frame(cv::Size size, cv::RNG &rng)
+{
+	cv::Mat frame(size, CV_8UC4);
+	rng.fill(frame, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(256));
+	for (int y = 80; y < size.height; y += 160) {
+		cv::putText(frame, "The quick brown fox 0123456789", cv::Point(40, y),
+			    cv::FONT_HERSHEY_DUPLEX, size.height / 540.0,
+			    cv::Scalar(255, 255, 255, 255), 3);
+	}
+	return frame;
+}
+
+// Odd sizes, so the vector loops always leave a scalar tail
+const cv::Size VERIFY_SIZES[] = {{1, 1}, {7, 3}, {33, 17}, {101, 63}, {641, 359}};
+const cv::Size TIMING_SIZE(1920, 1080);
+
+// A BGRA image of text on noise, or a binary one for the packing and dilation checks
+cv::Mat make_kernel_input(cv::Size size, cv::RNG &rng, bool binary)
+{
+	cv::Mat image(size, CV_8UC4);
+	rng.fill(image, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(256));
+	cv::putText(image, "Kernel 0123", cv::Point(0, size.height * 2 / 3),
+		    cv::FONT_HERSHEY_SIMPLEX, size.height / 60.0, cv::Scalar::all(255), 2);
+	if (binary) {
+		cv::Mat gray;
+		cv::cvtColor(image, gray, cv::COLOR_BGRA2GRAY);
+		cv::threshold(gray, image, 200, 255, cv::THRESH_BINARY);
+	}
+	return image;
+}
+
+// The same image with a few pixels changed
+cv::Mat change_some_pixels(const cv::Mat &image, cv::RNG &rng)
+{
+	cv::Mat changed = image.clone();
+	for (int i = 0; i < std::max(1, image.rows * image.cols / 50); i++) {
+		uint8_t *pixel = changed.ptr<uint8_t>(rng.uniform(0, image.rows)) +
+				 rng.uniform(0, image.cols) * image.channels();
+		pixel[rng.uniform(0, image.channels())] ^= (uint8_t)rng.uniform(1, 4);
+	}
+	return changed;
+}
+
+// Tesseract's one bit per pixel layout, built pixel by pixel
+cv::Mat unpack_bits(const std::vector<uint8_t> &bits, int bytes_per_line, cv::Size size)
+{
+	cv::Mat image(size, CV_8UC1);
+	for (int y = 0; y < size.height; y++) {
+		for (int x = 0; x < size.width; x++) {
+			const uint8_t byte = bits[(size_t)y * bytes_per_line + x / 8];
+			image.at<uint8_t>(y, x) = (byte >> (7 - x % 8)) & 1 ? 255 : 0;
+		}
+	}
+	return image;
+}
+
+double time_ms(const std::function<void()> &run)
+{
+	const uint64_t start_ns = get_time_ns();
+	for (int i = 0; i < ITERATIONS; i++) {
+		run();
+	}
+	return (double)(get_time_ns() - start_ns) / 1e6 / ITERATIONS;
+}
+
+struct kernel_check {
+	const char *name;
+	// runs the kernel at the level on the image, and OpenCV if level is SIMD_LEVEL_COUNT
+	std::function<cv::Mat(const cv::Mat &, const cv::Mat &, simd_level)> run;
+	// a grayscale image of 0 and 255 instead of BGRA
+	bool binary_input;
+	double tolerance;
+};
+
+cv::Mat to_gray(const cv::Mat &image)
+{
+	cv::Mat gray;
+	cv::cvtColor(image, gray, cv::COLOR_BGRA2GRAY);
+	return gray;
+}
+
+cv::Mat threshold_with(const cv::Mat &image, int type, simd_level level)
+{
+	cv::Mat binary;
+	if (level == SIMD_LEVEL_COUNT) {
+		cv::threshold(to_gray(image), binary, 128, 255, cv::THRESH_BINARY | type);
+		return binary;
+	}
+	const global_threshold_method method = type == cv::THRESH_OTSU ? GLOBAL_THRESHOLD_OTSU
+					       : type == cv::THRESH_TRIANGLE
+						       ? GLOBAL_THRESHOLD_TRIANGLE
+						       : GLOBAL_THRESHOLD_FIXED;
+	binarize_global(image, binary, method, 128, level);
+	return binary;
+}
+
+const std::vector<kernel_check> &kernel_checks()
+{
+	static const std::vector<kernel_check> checks = {
+		{"gray",
+		 [](const cv::Mat &image, const cv::Mat &, simd_level level) {
+			 cv::Mat gray;
+			 if (level == SIMD_LEVEL_COUNT) {
+				 return to_gray(image);
+			 }
+			 bgra_to_gray(image, gray, level);
+			 return gray;
+		 },
+		 false, 1.0},
+		{"threshold",
+		 [](const cv::Mat &image, const cv::Mat &, simd_level level) {
+			 return threshold_with(image, 0, level);
+		 },
+		 false, 0.0},
+		{"otsu",
+		 [](const cv::Mat &image, const cv::Mat &, simd_level level) {
+			 return threshold_with(image, cv::THRESH_OTSU, level);
+		 },
+		 false, 0.0},
+		{"triangle",
+		 [](const cv::Mat &image, const cv::Mat &, simd_level level) {
+			 return threshold_with(image, cv::THRESH_TRIANGLE, level);
+		 },
+		 false, 0.0},
+		{"changed",
+		 [](const cv::Mat &image, const cv::Mat &changed, simd_level level) {
+			 if (level == SIMD_LEVEL_COUNT) {
+				 cv::Mat diff;
+				 cv::absdiff(image, changed, diff);
+				 const int count = cv::countNonZero(to_gray(diff));
+				 return cv::Mat(1, 1, CV_64FC1, cv::Scalar((double)count));
+			 }
+			 const uint64_t count = count_changed_pixels(image, changed, level);
+			 return cv::Mat(1, 1, CV_64FC1, cv::Scalar((double)count));
+		 },
+		 false, 0.0},
+		{"dilate",
+		 [](const cv::Mat &image, const cv::Mat &, simd_level level) {
+			 cv::Mat dilated;
+			 if (level == SIMD_LEVEL_COUNT) {
+				 cv::dilate(image, dilated,
+					    cv::getStructuringElement(cv::MORPH_RECT,
+								      cv::Size(3, 3)),
+					    cv::Point(-1, -1), 2);
+			 } else {
+				 dilate_3x3(image, dilated, 2, level);
+			 }
+			 return dilated;
+		 },
+		 false, 0.0},
+		{"dilate_gray",
+		 [](const cv::Mat &image, const cv::Mat &, simd_level level) {
+			 cv::Mat dilated;
+			 if (level == SIMD_LEVEL_COUNT) {
+				 cv::dilate(image, dilated,
+					    cv::getStructuringElement(cv::MORPH_RECT,
+								      cv::Size(3, 3)));
+			 } else {
+				 dilate_3x3(image, dilated, 1, level);
+			 }
+			 return dilated;
+		 },
+		 true, 0.0},
+		{"pack",
+		 [](const cv::Mat &image, const cv::Mat &, simd_level level) {
+			 // OpenCV has no packing, the reference is the image itself
+			 if (level == SIMD_LEVEL_COUNT) {
+				 return image.clone();
+			 }
+			 std::vector<uint8_t> bits;
+			 int bytes_per_line = 0;
+			 if (!pack_binary(image, bits, bytes_per_line, level)) {
+				 return cv::Mat();
+			 }
+			 return unpack_bits(bits, bytes_per_line, image.size());
+		 },
+		 true, 0.0},
+	};
+	return checks;
+}
+
+double max_difference(const cv::Mat &a, const cv::Mat &b)
+{
+	if (a.size() != b.size() || a.type() != b.type()) {
+		return 256.0;
+	}
+	return a.empty() ? 0.0 : cv::norm(a, b, cv::NORM_INF);
+}
+
+} // namespace
+
+int run_kernel_verification()
+{
+	cv::RNG rng(0x5D1);
+	int result = 0;
+	printf("%-12s %-8s %10s %10s %10s\n", "kernel", "level", "max_diff", "ms", "opencv_ms");
+	for (const kernel_check &check : kernel_checks()) {
+		auto input_for = [&](cv::Size size) {
+			return make_kernel_input(size, rng, check.binary_input);
+		};
+		std::vector<cv::Mat> inputs;
+		std::vector<cv::Mat> changed;
+		for (const cv::Size &size : VERIFY_SIZES) {
+			inputs.push_back(input_for(size));
+			changed.push_back(change_some_pixels(inputs.back(), rng));
+		}
+		const cv::Mat timing_input = input_for(TIMING_SIZE);
+		const cv::Mat timing_changed = change_some_pixels(timing_input, rng);
+		const double opencv_ms = time_ms(
+			[&] { check.run(timing_input, timing_changed, SIMD_LEVEL_COUNT); });
+
+		for (int level = SIMD_LEVEL_SCALAR; level < SIMD_LEVEL_COUNT; level++) {
+			if (!simd_level_supported((simd_level)level)) {
+				continue;
+			}
+			double max_diff = 0.0;
+			for (size_t i = 0; i < inputs.size(); i++) {
+				const cv::Mat kernel =
+					check.run(inputs[i], changed[i], (simd_level)level);
+				const cv::Mat opencv =
+					check.run(inputs[i], changed[i], SIMD_LEVEL_COUNT);
+				max_diff = std::max(max_diff, max_difference(kernel, opencv));
+			}
+			const double ms = time_ms([&] {
+				check.run(timing_input, timing_changed, (simd_level)level);
+			});
+			printf("%-12s %-8s %10.0f %10.3f %10.3f\n", check.name,
+			       simd_level_name((simd_level)level), max_diff, ms, opencv_ms);
+			if (max_diff > check.tolerance) {
+				result = 1;
+			}
+		}
+	}
+	return result;
+}
+
+int run_capture_comparison(const ocr_pipeline_settings &base_settings)
+{
+	cv::RNG rng(0x0C5);
+	int result = 0;
+	printf("%-10s %-12s %10s %10s\n", "source", "path", "ms", "max_diff");
+	for (const cv::Size &size : SOURCE_SIZES) {
+		const cv::Mat mapped = make_source_frame(size, rng);
+		char source_name[32];
+		snprintf(source_name, sizeof(source_name), "%dx%d", size.width, size.height);
+
+		// the render thread copies out of the mapped surface, the OCR thread clones the
+		// input and converts it to gray
+		cv::Mat input;
+		cv::Mat reference;
+		uint64_t start_ns = get_time_ns();
+		for (int i = 0; i < ITERATIONS; i++) {
+			mapped.copyTo(input);
+			const cv::Mat taken = input.clone();
+			cv::cvtColor(taken, reference, cv::COLOR_BGRA2GRAY);
+		}
+		printf("%-10s %-12s %10.3f %10s\n", source_name, "multi-pass",
+		       (double)(get_time_ns() - start_ns) / 1e6 / ITERATIONS, "-");
+
+		for (int level = SIMD_LEVEL_SCALAR; level < SIMD_LEVEL_COUNT; level++) {
+			if (!simd_level_supported((simd_level)level)) {
+				continue;
+			}
+			cv::Mat fused;
+			start_ns = get_time_ns();
+			for (int i = 0; i < ITERATIONS; i++) {
+				bgra_to_gray(mapped, fused, (simd_level)level);
+			}
+			const double ms = (double)(get_time_ns() - start_ns) / 1e6 / ITERATIONS;
+			const double max_diff = cv::norm(fused, reference, cv::NORM_INF);
+			printf("%-10s %-12s %10.3f %10.0f\n", source_name,
+			       simd_level_name((simd_level)level), ms, max_diff);
+			if (max_diff > 1.0) {
+				result = 1;
+			}
+		}
+	}
+
+	// the capture converts to grayscale only where preprocess_image then gives the same
+	// image as for the BGRA frame
+	printf("\n%-10s %-10s %-6s %10s\n", "mode", "dilation", "input", "max_diff");
+	const cv::Mat mapped = make_source_frame(SOURCE_SIZES[0], rng);
+	cv::Mat gray;
+	bgra_to_gray(mapped, gray);
+	for (int mode = 0; mode < BINARIZATION_MODE_COUNT; mode++) {
+		for (int dilation : {0, 2}) {
+			ocr_pipeline_settings settings = base_settings;
+			settings.binarizationMode = mode;
+			settings.dilationIterations = dilation;
+			const bool gray_input = preprocess_accepts_gray(settings);
+			const cv::Mat from_capture =
+				preprocess_image(gray_input ? gray : mapped, settings);
+			const double max_diff =
+				max_difference(from_capture, preprocess_image(mapped, settings));
+			printf("bin%-7d %-10d %-6s %10.0f\n", mode, dilation,
+			       gray_input ? "gray" : "bgra", max_diff);
+			if (max_diff > 0.0) {
+				result = 1;
+			}
+		}
+	}
+	return result;
+}
@@ -0,0 +1,35 @@
+#ifndef KERNEL_SUITE_H
+#define KERNEL_SUITE_H
+
+#include "ocr-pipeline.h"
+
+/**
+  * @brief Compare the fused capture conversion with the multi-pass path it replaces.
+  *
+  * For typical source sizes, times copying a mapped BGRA frame, taking it on the OCR thread
+  * and converting it to grayscale with OpenCV, against bgra_to_gray reading the mapped frame
+  * at every instruction set level the CPU supports. Also reports the largest pixel difference
+  * between the two paths.
+  *
+  * Then checks, for every binarization mode with and without dilation, that preprocess_image
+  * gives the same image for the grayscale frame the capture hands over as for the BGRA frame
+  * wherever preprocess_accepts_gray lets the capture convert it.
+  *
+  * @return 0, or 1 if a level differs from OpenCV by more than one gray level, or the
+  * pipeline output changes with the grayscale input
+*/
+int run_capture_comparison(const ocr_pipeline_settings &base_settings);
+
+/**
+  * @brief Check the preprocessing kernels against the OpenCV calls they replace.
+  *
+  * Runs grayscale conversion, fixed, Otsu and triangle binarization, change counting, 3x3
+  * dilation and bit packing on random images of odd sizes, at every instruction set level the
+  * CPU supports, and times each kernel on a 1080p frame against OpenCV.
+  *
+  * @return 0, or 1 if a kernel differs from OpenCV (by more than one gray level for the
+  * grayscale conversion)
+*/
+int run_kernel_verification();
+
+#endif /* KERNEL_SUITE_H */
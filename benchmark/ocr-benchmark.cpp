@@ -0,0 +1,583 @@
+/*
+OCR Plugin - offline benchmark
+
+Runs the OCR pipeline of the filter headless (without OBS or a GPU) over a folder of PNG
+frames or a video file and reports throughput, per-stage latency, peak memory and the
+recognized text per frame. Recordings made by the filter (.ocrrec) are replayed at maximum
+speed, or at the recorded pace with --realtime. With --synthetic it instead runs the synthetic accuracy and speed
+suite, optionally gated against a baseline file.
+
+Usage: obs-ocr-benchmark [options] <frames folder | video file | recording.ocrrec>
+       obs-ocr-benchmark --synthetic [--baseline <file>] [--write-baseline <file>]
+       obs-ocr-benchmark --capture-compare [--settings <file>]
+       obs-ocr-benchmark --verify-kernels
+       obs-ocr-benchmark --verify-arena
+*/
+
+#include "ocr-pipeline.h"
+#include "consts.h"
+#include "synthetic-suite.h"
+#include "kernel-suite.h"
+#include "arena-suite.h"
+#include "ocr-trace.h"
+#include "frame-recorder.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <inja/inja.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+struct benchmark_options {
+	std::string input;
+	std::string settings_path;
+	std::string tessdata_path = "data/tessdata";
+	std::string output_path;
+	std::string trace_path;
+	size_t max_frames = 0;
+	bool quiet = false;
+	bool realtime = false;
+	bool synthetic = false;
+	synthetic_suite_options suite;
+	// compare the capture conversion paths instead of running OCR
+	bool capture_compare = false;
+	// check the preprocessing kernels against OpenCV instead of running OCR
+	bool verify_kernels = false;
+	// check the buffer arena of the OCR thread and its teardown instead of running OCR
+	bool verify_arena = false;
+	// find the boxes by layout analysis only, as the filter does when no output needs text
+	bool detect_only = false;
+};
+
+/**
+  * @brief A source of BGRA frames, the format the filter captures from OBS
+*/
+class frame_source {
+public:
+	virtual ~frame_source() = default;
+	virtual bool next(cv::Mat &frameBGRA) = 0;
+};
+
+cv::Mat to_bgra(const cv::Mat &image)
+{
+	cv::Mat bgra;
+	switch (image.channels()) {
+	case 1:
+		cv::cvtColor(image, bgra, cv::COLOR_GRAY2BGRA);
+		break;
+	case 3:
+		cv::cvtColor(image, bgra, cv::COLOR_BGR2BGRA);
+		break;
+	default:
+		bgra = image;
+		break;
+	}
+	return bgra;
+}
+
+class directory_frame_source : public frame_source {
+public:
+	explicit directory_frame_source(const std::string &folder)
+	{
+		for (const auto &entry : std::filesystem::directory_iterator(folder)) {
+			std::string extension = entry.path().extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(),
+				       ::tolower);
+			if (entry.is_regular_file() && extension == ".png") {
+				files.push_back(entry.path().string());
+			}
+		}
+		std::sort(files.begin(), files.end());
+	}
+
+	bool next(cv::Mat &frameBGRA) override
+	{
+		while (index < files.size()) {
+			cv::Mat image = cv::imread(files[index++], cv::IMREAD_UNCHANGED);
+			if (image.empty()) {
+				fprintf(stderr, "Skipping unreadable frame: %s\n",
+					files[index - 1].c_str());
+				continue;
+			}
+			frameBGRA = to_bgra(image);
+			return true;
+		}
+		return false;
+	}
+
+private:
+	std::vector<std::string> files;
+	size_t index = 0;
+};
+
+class video_frame_source : public frame_source {
+public:
+	explicit video_frame_source(const std::string &path) : capture(path) {}
+
+	bool is_open() const { return capture.isOpened(); }
+
+	bool next(cv::Mat &frameBGRA) override
+	{
+		cv::Mat frame;
+		if (!capture.read(frame) || frame.empty()) {
+			return false;
+		}
+		frameBGRA = to_bgra(frame);
+		return true;
+	}
+
+private:
+	cv::VideoCapture capture;
+};
+
+/**
+  * @brief Replays a recording made by the filter, optionally at the recorded pace
+*/
+class recording_frame_source : public frame_source {
+public:
+	recording_frame_source(const std::string &path, bool realtime_) : realtime(realtime_)
+	{
+		if (!reader.open(path)) {
+			throw std::runtime_error("Failed to open recording: " + path);
+		}
+	}
+
+	bool next(cv::Mat &frameBGRA) override
+	{
+		cv::Mat frame;
+		uint64_t timestamp_ns = 0;
+		if (!reader.read_frame(index++, frame, timestamp_ns)) {
+			return false;
+		}
+		if (realtime) {
+			const uint64_t now_ns = get_time_ns();
+			if (index == 1) {
+				first_timestamp_ns = timestamp_ns;
+				replay_start_ns = now_ns;
+			}
+			const uint64_t due_ns = replay_start_ns + (timestamp_ns - first_timestamp_ns);
+			if (due_ns > now_ns) {
+				std::this_thread::sleep_for(std::chrono::nanoseconds(due_ns - now_ns));
+			}
+		}
+		// copy out of the mapped file, the pipeline may keep the frame around
+		cv::Mat bgra = to_bgra(frame);
+		frameBGRA = bgra.data == frame.data ? bgra.clone() : bgra;
+		return true;
+	}
+
+private:
+	frame_recording_reader reader;
+	bool realtime;
+	size_t index = 0;
+	uint64_t first_timestamp_ns = 0;
+	uint64_t replay_start_ns = 0;
+};
+
+/**
+  * @brief Read pipeline settings from a JSON file using the filter's setting keys
+*/
+ocr_pipeline_settings load_settings(const std::string &path, std::string &output_template)
+{
+	ocr_pipeline_settings settings;
+	settings.char_whitelist = WHITELIST_CHARS_ENGLISH;
+	output_template = "{{output}}";
+	if (path.empty()) {
+		return settings;
+	}
+
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open settings file: " + path);
+	}
+	nlohmann::json json = nlohmann::json::parse(file);
+
+	settings.language = json.value("language", settings.language);
+	settings.pageSegmentationMode =
+		json.value("page_segmentation_mode", settings.pageSegmentationMode);
+	settings.binarizationMode = json.value("binarization_mode", settings.binarizationMode);
+	settings.binarizationThreshold =
+		json.value("binarization_threshold", settings.binarizationThreshold);
+	settings.binarizationBlockSize =
+		json.value("binarization_block_size", settings.binarizationBlockSize);
+	settings.dilationIterations =
+		json.value("dilation_iterations", settings.dilationIterations);
+	settings.rescaleImage = json.value("rescale_image", settings.rescaleImage);
+	settings.rescaleTargetSize = json.value("rescale_target_size", settings.rescaleTargetSize);
+	settings.char_whitelist = json.value("char_whitelist", settings.char_whitelist);
+	settings.conf_threshold = json.value("conf_threshold", settings.conf_threshold);
+	settings.enable_smoothing = json.value("enable_smoothing", settings.enable_smoothing);
+	settings.word_length = json.value("word_length", settings.word_length);
+	settings.window_size = json.value("window_size", settings.window_size);
+	settings.update_on_change = json.value("update_on_change", settings.update_on_change);
+	settings.update_on_change_threshold =
+		json.value("update_on_change_threshold", settings.update_on_change_threshold);
+	output_template = json.value("output_formatting", output_template);
+	return settings;
+}
+
+/**
+  * @brief Peak resident set size of this process in bytes, or 0 if unavailable
+*/
+uint64_t get_peak_rss_bytes()
+{
+#if defined(__linux__) || defined(__APPLE__)
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+#if defined(__APPLE__)
+	return (uint64_t)usage.ru_maxrss;
+#else
+	return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+#else
+	return 0;
+#endif
+}
+
+struct latency_summary {
+	double mean_ms = 0;
+	double p50_ms = 0;
+	double p90_ms = 0;
+	double p99_ms = 0;
+	double max_ms = 0;
+};
+
+latency_summary summarize(std::vector<uint64_t> samples_ns)
+{
+	latency_summary summary;
+	if (samples_ns.empty()) {
+		return summary;
+	}
+	std::sort(samples_ns.begin(), samples_ns.end());
+	auto percentile = [&samples_ns](double p) {
+		size_t index = (size_t)(p * (double)(samples_ns.size() - 1) + 0.5);
+		return (double)samples_ns[index] / 1e6;
+	};
+	uint64_t total_ns = 0;
+	for (uint64_t sample : samples_ns) {
+		total_ns += sample;
+	}
+	summary.mean_ms = (double)total_ns / (double)samples_ns.size() / 1e6;
+	summary.p50_ms = percentile(0.5);
+	summary.p90_ms = percentile(0.9);
+	summary.p99_ms = percentile(0.99);
+	summary.max_ms = (double)samples_ns.back() / 1e6;
+	return summary;
+}
+
+nlohmann::json summary_to_json(const latency_summary &summary)
+{
+	return {{"mean_ms", summary.mean_ms},
+		{"p50_ms", summary.p50_ms},
+		{"p90_ms", summary.p90_ms},
+		{"p99_ms", summary.p99_ms},
+		{"max_ms", summary.max_ms}};
+}
+
+void print_usage(const char *program)
+{
+	fprintf(stderr,
+		"Usage: %s [options] <frames folder | video file | recording.ocrrec>\n"
+		"       %s --synthetic [options]\n"
+		"Options:\n"
+		"  --settings <file>   JSON settings, same keys as the filter settings\n"
+		"  --tessdata <dir>    tessdata folder (default: data/tessdata)\n"
+		"  --output <file>     write results as JSON\n"
+		"  --max-frames <n>    stop after n frames\n"
+		"  --quiet             do not print the recognized text per frame\n"
+		"  --trace <file>      record pipeline spans as Chrome trace-event JSON\n"
+		"  --realtime          replay recordings at the recorded pace\n"
+		"  --detect-only       find the boxes by layout analysis, without recognition\n"
+		"Synthetic suite options:\n"
+		"  --synthetic              run the synthetic accuracy and speed suite\n"
+		"  --baseline <file>        fail if results regress against this baseline\n"
+		"  --write-baseline <file>  write the results as a new baseline\n"
+		"  --cer-tolerance <x>      allowed absolute CER increase (default 0.01)\n"
+		"  --time-tolerance <x>     allowed relative time increase (default: off)\n"
+		"  --rescale-compare        compare bilinear and area rescaling instead\n"
+		"Kernel options:\n"
+		"  --capture-compare   compare the fused capture conversion with OpenCV\n"
+		"  --verify-kernels    check the preprocessing kernels against OpenCV\n"
+		"  --verify-arena      check the buffer arena recycling and teardown\n",
+		program, program);
+}
+
+bool parse_options(int argc, char **argv, benchmark_options &options)
+{
+	try {
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			const bool has_value = i + 1 < argc;
+			if (arg == "--settings" && has_value) {
+				options.settings_path = argv[++i];
+			} else if (arg == "--tessdata" && has_value) {
+				options.tessdata_path = argv[++i];
+			} else if (arg == "--output" && has_value) {
+				options.output_path = argv[++i];
+			} else if (arg == "--max-frames" && has_value) {
+				options.max_frames = std::stoul(argv[++i]);
+			} else if (arg == "--trace" && has_value) {
+				options.trace_path = argv[++i];
+			} else if (arg == "--realtime") {
+				options.realtime = true;
+			} else if (arg == "--detect-only") {
+				options.detect_only = true;
+			} else if (arg == "--quiet") {
+				options.quiet = true;
+			} else if (arg == "--synthetic") {
+				options.synthetic = true;
+			} else if (arg == "--baseline" && has_value) {
+				options.suite.baseline_path = argv[++i];
+			} else if (arg == "--write-baseline" && has_value) {
+				options.suite.write_baseline_path = argv[++i];
+			} else if (arg == "--cer-tolerance" && has_value) {
+				options.suite.cer_tolerance = std::stod(argv[++i]);
+			} else if (arg == "--time-tolerance" && has_value) {
+				options.suite.time_tolerance = std::stod(argv[++i]);
+			} else if (arg == "--rescale-compare") {
+				options.synthetic = true;
+				options.suite.rescale_compare = true;
+			} else if (arg == "--capture-compare") {
+				options.capture_compare = true;
+			} else if (arg == "--verify-kernels") {
+				options.verify_kernels = true;
+			} else if (arg == "--verify-arena") {
+				options.verify_arena = true;
+			} else if (arg.rfind("--", 0) == 0) {
+				return false;
+			} else {
+				options.input = arg;
+			}
+		}
+	} catch (const std::invalid_argument &) {
+		// a number option given something else
+		return false;
+	} catch (const std::out_of_range &) {
+		return false;
+	}
+	return options.synthetic || options.capture_compare || options.verify_kernels ||
+	       options.verify_arena || !options.input.empty();
+}
+
+std::unique_ptr<frame_source> open_frame_source(const benchmark_options &options)
+{
+	const std::string &input = options.input;
+	if (std::filesystem::is_directory(input)) {
+		return std::make_unique<directory_frame_source>(input);
+	}
+	if (std::filesystem::path(input).extension() == ".ocrrec") {
+		return std::make_unique<recording_frame_source>(input, options.realtime);
+	}
+	auto video = std::make_unique<video_frame_source>(input);
+	if (!video->is_open()) {
+		throw std::runtime_error("Failed to open input: " + input);
+	}
+	return video;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	benchmark_options options;
+	if (!parse_options(argc, argv, options)) {
+		print_usage(argv[0]);
+		return 2;
+	}
+
+	if (!options.trace_path.empty()) {
+		ocr_trace_enable();
+		ocr_trace_set_thread_name("benchmark");
+	}
+
+	try {
+		std::string output_template;
+		ocr_pipeline_settings settings =
+			load_settings(options.settings_path, output_template);
+		if (options.capture_compare) {
+			return run_capture_comparison(settings);
+		}
+		if (options.verify_kernels) {
+			return run_kernel_verification();
+		}
+		if (options.verify_arena) {
+			return run_arena_verification();
+		}
+		if (options.synthetic) {
+			options.suite.tessdata_path = options.tessdata_path;
+			if (options.suite.rescale_compare) {
+				return run_rescale_comparison(options.suite, settings);
+			}
+			return run_synthetic_suite(options.suite, settings);
+		}
+		std::unique_ptr<frame_source> source = open_frame_source(options);
+
+		const uint64_t load_start_ns = get_time_ns();
+		std::unique_ptr<tesseract::TessBaseAPI> model(create_tesseract_model(
+			options.tessdata_path.c_str(), settings.language, nullptr, 0));
+		apply_tesseract_settings(model.get(), settings.pageSegmentationMode,
+					 settings.char_whitelist);
+		const uint64_t load_time_ns = get_time_ns() - load_start_ns;
+
+		std::unique_ptr<CharacterBasedSmoothingFilter> smoothing_filter;
+		if (settings.enable_smoothing) {
+			smoothing_filter = std::make_unique<CharacterBasedSmoothingFilter>(
+				settings.word_length, settings.window_size);
+		}
+		inja::Environment env;
+
+		std::vector<uint64_t> stage_samples_ns[OCR_STAGE_COUNT];
+		std::vector<uint64_t> frame_samples_ns;
+		nlohmann::json frames_json = nlohmann::json::array();
+		size_t frame_count = 0;
+		size_t skipped_unchanged = 0;
+		cv::Mat frameBGRA;
+		cv::Mat lastFrameBGRA;
+
+		const uint64_t run_start_ns = get_time_ns();
+		while ((options.max_frames == 0 || frame_count < options.max_frames) &&
+		       source->next(frameBGRA)) {
+			const size_t frame_index = frame_count++;
+			const uint64_t frame_start_ns = get_time_ns();
+			ocr_stage_timings timings;
+
+			if (settings.update_on_change && !lastFrameBGRA.empty()) {
+				const bool changed =
+					image_has_changed(frameBGRA, lastFrameBGRA,
+							  settings.update_on_change_threshold);
+				timings.stage_ns[OCR_STAGE_CHANGE_DETECTION] =
+					get_time_ns() - frame_start_ns;
+				stage_samples_ns[OCR_STAGE_CHANGE_DETECTION].push_back(
+					timings.stage_ns[OCR_STAGE_CHANGE_DETECTION]);
+				if (!changed) {
+					skipped_unchanged++;
+					continue;
+				}
+			}
+			lastFrameBGRA = frameBGRA.clone();
+
+			cv::Mat imageForOCR = preprocess_image(frameBGRA, settings, nullptr, &timings);
+
+			uint64_t stage_start_ns = get_time_ns();
+			int confidence = 0;
+			std::string text;
+			std::vector<OCRBox> boxes;
+			if (options.detect_only) {
+				boxes = detect_layout_boxes(model.get(), imageForOCR,
+							    settings.pageSegmentationMode);
+				timings.stage_ns[OCR_STAGE_DETECTION_BOXES] =
+					get_time_ns() - stage_start_ns;
+			} else {
+				text = recognize_text(model.get(), imageForOCR,
+						      settings.conf_threshold, &confidence);
+				// like run_tesseract_ocr, a reading below the threshold is empty
+				if (smoothing_filter) {
+					text = smoothing_filter->add_reading(text);
+				}
+				timings.stage_ns[OCR_STAGE_RECOGNITION] =
+					get_time_ns() - stage_start_ns;
+
+				stage_start_ns = get_time_ns();
+				boxes = get_text_detection_boxes(model.get(),
+								 settings.pageSegmentationMode,
+								 settings.conf_threshold,
+								 frameBGRA.size());
+				timings.stage_ns[OCR_STAGE_DETECTION_BOXES] =
+					get_time_ns() - stage_start_ns;
+			}
+
+			frame_samples_ns.push_back(get_time_ns() - frame_start_ns);
+			for (int stage = OCR_STAGE_BINARIZATION; stage < OCR_STAGE_COUNT; stage++) {
+				stage_samples_ns[stage].push_back(timings.stage_ns[stage]);
+			}
+
+			OCR_TRACE_SPAN("output");
+			std::string output;
+			if (!text.empty()) {
+				nlohmann::json data;
+				data["output"] = text;
+				output = env.render(output_template, data);
+			}
+			if (!options.quiet) {
+				printf("frame %zu: %s\n", frame_index, output.c_str());
+			}
+			frames_json.push_back({{"frame", frame_index},
+					       {"text", output},
+					       {"confidence", confidence},
+					       {"boxes", boxes.size()},
+					       {"time_ms", (double)frame_samples_ns.back() / 1e6}});
+		}
+		const uint64_t run_time_ns = get_time_ns() - run_start_ns;
+
+		const double run_time_s = (double)run_time_ns / 1e9;
+		const uint64_t peak_rss_bytes = get_peak_rss_bytes();
+		nlohmann::json results;
+		results["input"] = options.input;
+		results["model_load_ms"] = (double)load_time_ns / 1e6;
+		results["frames"] = frame_count;
+		results["frames_processed"] = frame_samples_ns.size();
+		results["frames_skipped_unchanged"] = skipped_unchanged;
+		results["run_time_s"] = run_time_s;
+		results["throughput_fps"] =
+			run_time_s > 0 ? (double)frame_count / run_time_s : 0.0;
+		results["peak_rss_bytes"] = peak_rss_bytes;
+		results["frame_latency"] = summary_to_json(summarize(frame_samples_ns));
+		for (int stage = 0; stage < OCR_STAGE_COUNT; stage++) {
+			results["stage_latency"][ocr_pipeline_stage_name(stage)] =
+				summary_to_json(summarize(stage_samples_ns[stage]));
+		}
+
+		printf("\nframes: %zu (processed %zu, skipped unchanged %zu)\n", frame_count,
+		       frame_samples_ns.size(), skipped_unchanged);
+		printf("model load: %.1f ms\n", (double)load_time_ns / 1e6);
+		printf("throughput: %.2f fps over %.2f s\n",
+		       results["throughput_fps"].get<double>(), run_time_s);
+		printf("peak RSS: %.1f MB\n", (double)peak_rss_bytes / (1024.0 * 1024.0));
+		printf("%-18s %9s %9s %9s %9s %9s\n", "stage", "mean_ms", "p50_ms", "p90_ms",
+		       "p99_ms", "max_ms");
+		for (int stage = 0; stage < OCR_STAGE_COUNT; stage++) {
+			latency_summary summary = summarize(stage_samples_ns[stage]);
+			printf("%-18s %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+			       ocr_pipeline_stage_name(stage), summary.mean_ms, summary.p50_ms,
+			       summary.p90_ms, summary.p99_ms, summary.max_ms);
+		}
+		latency_summary frame_summary = summarize(frame_samples_ns);
+		printf("%-18s %9.3f %9.3f %9.3f %9.3f %9.3f\n", "frame", frame_summary.mean_ms,
+		       frame_summary.p50_ms, frame_summary.p90_ms, frame_summary.p99_ms,
+		       frame_summary.max_ms);
+
+		if (!options.output_path.empty()) {
+			results["per_frame"] = frames_json;
+			std::ofstream output_file(options.output_path);
+			output_file << results.dump(2) << "\n";
+		}
+		if (!options.trace_path.empty() && !ocr_trace_dump(options.trace_path)) {
+			fprintf(stderr, "Failed to write trace to %s\n", options.trace_path.c_str());
+		}
+	} catch (const std::exception &e) {
+		fprintf(stderr, "Benchmark failed: %s\n", e.what());
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,401 @@
+#include "synthetic-suite.h"
+#include "simd-kernels.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <inja/inja.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace {
+
+struct language_samples {
+	const char *language;
+	std::vector<const char *> texts;
+};
+
+// The Hershey fonts used for rendering only cover ASCII, so only languages that can be written
+// (mostly) in ASCII are exercised. Non-latin models shipped in data/tessdata are skipped.
+const std::vector<language_samples> SAMPLES = {
+	{"eng",
+	 {"The quick brown fox", "Score 21 to 17", "Next match at 8:30 PM", "GAME OVER",
+	  "Player One wins", "Round 3 of 12"}},
+	{"fra", {"Bonjour le monde", "Prochain match", "Temps restant 2:45", "Joueur suivant"}},
+	{"deu", {"Guten Morgen", "Spielstand 3 zu 1", "Naechste Runde", "Neue Nachricht"}},
+	{"spa", {"Buenos dias", "Partido en vivo", "Tiempo 45 minutos", "Siguiente jugador"}},
+	{"ita", {"Buongiorno a tutti", "Partita in corso", "Punteggio finale", "Prossimo turno"}},
+	{"por", {"Bom dia a todos", "Placar final", "Tempo restante", "Proximo jogador"}},
+	{"scoreboard", {"12 34", "08 15", "99 00", "3 21"}},
+	{"daktronics", {"12 34", "08 15", "99 00", "3 21"}},
+};
+
+const int FONTS[] = {cv::FONT_HERSHEY_SIMPLEX, cv::FONT_HERSHEY_DUPLEX, cv::FONT_HERSHEY_COMPLEX,
+		     cv::FONT_HERSHEY_TRIPLEX, cv::FONT_HERSHEY_PLAIN};
+const double FONT_SCALES[] = {0.8, 1.2, 2.0};
+// text / background color pairs, BGR
+const std::pair<cv::Scalar, cv::Scalar> COLORS[] = {
+	{cv::Scalar(0, 0, 0), cv::Scalar(255, 255, 255)},
+	{cv::Scalar(255, 255, 255), cv::Scalar(20, 20, 20)},
+	{cv::Scalar(0, 255, 255), cv::Scalar(120, 40, 0)},
+	{cv::Scalar(40, 40, 200), cv::Scalar(220, 220, 200)},
+};
+const double NOISE_LEVELS[] = {0.0, 8.0, 20.0};
+const int PAGE_SEGMENTATION_MODES[] = {tesseract::PSM_AUTO, tesseract::PSM_SINGLE_BLOCK,
+				       tesseract::PSM_SINGLE_LINE, tesseract::PSM_SPARSE_TEXT};
+const int BINARIZATION_MODE_COUNT = 6;
+
+struct interpolation {
+	const char *name;
+	int flag;
+};
+// bilinear is what the CPU rescale and the bilinear GPU rescale do, area the area GPU rescale
+const interpolation INTERPOLATIONS[] = {{"linear", cv::INTER_LINEAR}, {"area", cv::INTER_AREA}};
+// the other interpolations are compared to this one
+const size_t AREA_INTERPOLATION = 1;
+
+struct synthetic_case {
+	std::string truth;
+	std::vector<cv::Mat> frames;
+};
+
+/**
+  * @brief Render a frame with known text: varied font, size, colors, background and noise
+*/
+cv::Mat render_frame(const std::string &text, size_t variant, size_t frame, cv::RNG &rng)
+{
+	const int font = FONTS[variant % std::size(FONTS)];
+	const double scale = FONT_SCALES[(variant / 2) % std::size(FONT_SCALES)];
+	const auto &colors = COLORS[(variant / 3) % std::size(COLORS)];
+	const double noise = NOISE_LEVELS[(variant + frame) % std::size(NOISE_LEVELS)];
+	const int thickness = scale > 1.5 ? 2 : 1;
+
+	int baseline = 0;
+	cv::Size text_size = cv::getTextSize(text, font, scale, thickness, &baseline);
+	const int margin = 20;
+	cv::Mat frameBGR(text_size.height + baseline + 2 * margin, text_size.width + 2 * margin,
+			 CV_8UC3, colors.second);
+
+	// every other variant gets a gradient background
+	if (variant % 2 == 1) {
+		for (int y = 0; y < frameBGR.rows; y++) {
+			const double t = (double)y / (double)frameBGR.rows;
+			frameBGR.row(y) = colors.second * (1.0 - 0.3 * t);
+		}
+	}
+
+	cv::putText(frameBGR, text, cv::Point(margin, margin + text_size.height), font, scale,
+		    colors.first, thickness, cv::LINE_AA);
+
+	if (noise > 0) {
+		cv::Mat noiseImage(frameBGR.size(), CV_16SC3);
+		rng.fill(noiseImage, cv::RNG::NORMAL, 0, noise);
+		cv::Mat noisy;
+		frameBGR.convertTo(noisy, CV_16SC3);
+		noisy += noiseImage;
+		noisy.convertTo(frameBGR, CV_8UC3);
+	}
+
+	cv::Mat frameBGRA;
+	cv::cvtColor(frameBGR, frameBGRA, cv::COLOR_BGR2BGRA);
+	return frameBGRA;
+}
+
+std::string normalize_whitespace(const std::string &text)
+{
+	std::string normalized;
+	bool in_space = false;
+	for (char c : strip(text)) {
+		if (c == ' ' || c == '\n' || c == '\t' || c == '\r') {
+			in_space = true;
+			continue;
+		}
+		if (in_space && !normalized.empty()) {
+			normalized += ' ';
+		}
+		in_space = false;
+		normalized += c;
+	}
+	return normalized;
+}
+
+std::string config_key(const std::string &language, int binarization_mode, int psm)
+{
+	return language + "/bin" + std::to_string(binarization_mode) + "/psm" +
+	       std::to_string(psm);
+}
+
+} // namespace
+
+double character_error_rate(const std::string &truth, const std::string &recognized)
+{
+	const std::string a = normalize_whitespace(truth);
+	const std::string b = normalize_whitespace(recognized);
+	if (a.empty()) {
+		return b.empty() ? 0.0 : 1.0;
+	}
+	// Levenshtein distance, single row
+	std::vector<size_t> row(b.size() + 1);
+	for (size_t j = 0; j <= b.size(); j++) {
+		row[j] = j;
+	}
+	for (size_t i = 1; i <= a.size(); i++) {
+		size_t diagonal = row[0];
+		row[0] = i;
+		for (size_t j = 1; j <= b.size(); j++) {
+			const size_t above = row[j];
+			row[j] = std::min({row[j] + 1, row[j - 1] + 1,
+					   diagonal + (a[i - 1] == b[j - 1] ? 0 : 1)});
+			diagonal = above;
+		}
+	}
+	return std::min(1.0, (double)row[b.size()] / (double)a.size());
+}
+
+int run_synthetic_suite(const synthetic_suite_options &options,
+			const ocr_pipeline_settings &base_settings)
+{
+	nlohmann::json results = nlohmann::json::array();
+	cv::RNG rng(0x0C5);
+
+	for (const auto &samples : SAMPLES) {
+		const std::string traineddata = options.tessdata_path + "/" + samples.language +
+						".traineddata";
+		if (!std::filesystem::exists(traineddata)) {
+			continue;
+		}
+
+		// render the cases for this language once, they are shared by all configurations
+		std::vector<synthetic_case> cases;
+		for (size_t variant = 0; variant < options.cases_per_language; variant++) {
+			synthetic_case c;
+			c.truth = samples.texts[variant % samples.texts.size()];
+			for (size_t frame = 0; frame < options.frames_per_case; frame++) {
+				c.frames.push_back(render_frame(c.truth, variant, frame, rng));
+			}
+			cases.push_back(std::move(c));
+		}
+
+		std::unique_ptr<tesseract::TessBaseAPI> model(create_tesseract_model(
+			options.tessdata_path.c_str(), samples.language, nullptr, 0));
+
+		for (int binarization_mode = 0; binarization_mode < BINARIZATION_MODE_COUNT;
+		     binarization_mode++) {
+			for (int psm : PAGE_SEGMENTATION_MODES) {
+				ocr_pipeline_settings settings = base_settings;
+				settings.language = samples.language;
+				settings.binarizationMode = binarization_mode;
+				settings.pageSegmentationMode = psm;
+				apply_tesseract_settings(model.get(), psm, settings.char_whitelist);
+
+				double total_cer = 0;
+				uint64_t total_time_ns = 0;
+				size_t frame_count = 0;
+				for (const auto &c : cases) {
+					std::unique_ptr<CharacterBasedSmoothingFilter> smoothing;
+					if (settings.enable_smoothing) {
+						smoothing = std::make_unique<
+							CharacterBasedSmoothingFilter>(
+							settings.word_length, settings.window_size);
+					}
+					for (const auto &frameBGRA : c.frames) {
+						const uint64_t start_ns = get_time_ns();
+						// what the capture hands over
+						cv::Mat captured = frameBGRA;
+						if (preprocess_accepts_gray(settings)) {
+							bgra_to_gray(frameBGRA, captured);
+						}
+						cv::Mat imageForOCR =
+							preprocess_image(captured, settings);
+						std::string text = recognize_text(
+							model.get(), imageForOCR,
+							settings.conf_threshold);
+						// like the plugin, empty below the threshold
+						if (smoothing) {
+							text = smoothing->add_reading(text);
+						}
+						total_time_ns += get_time_ns() - start_ns;
+						total_cer += character_error_rate(c.truth, text);
+						frame_count++;
+					}
+				}
+				const double count = frame_count ? (double)frame_count : 1.0;
+				const double cer = total_cer / count;
+				const double ms_per_frame = (double)total_time_ns / 1e6 / count;
+				printf("%-28s cer %.4f  %8.2f ms/frame\n",
+				       config_key(samples.language, binarization_mode, psm).c_str(),
+				       cer, ms_per_frame);
+				results.push_back({{"language", samples.language},
+						   {"binarization_mode", binarization_mode},
+						   {"page_segmentation_mode", psm},
+						   {"frames", frame_count},
+						   {"cer", cer},
+						   {"ms_per_frame", ms_per_frame}});
+			}
+		}
+	}
+
+	if (!options.write_baseline_path.empty()) {
+		nlohmann::json baseline;
+		baseline["version"] = 1;
+		baseline["cases_per_language"] = options.cases_per_language;
+		baseline["frames_per_case"] = options.frames_per_case;
+		baseline["results"] = results;
+		std::ofstream file(options.write_baseline_path);
+		file << baseline.dump(2) << "\n";
+		printf("Wrote baseline to %s\n", options.write_baseline_path.c_str());
+	}
+
+	if (options.baseline_path.empty()) {
+		return 0;
+	}
+
+	std::ifstream baseline_file(options.baseline_path);
+	if (!baseline_file.is_open()) {
+		fprintf(stderr, "Failed to open baseline: %s\n", options.baseline_path.c_str());
+		return 1;
+	}
+	nlohmann::json baseline = nlohmann::json::parse(baseline_file);
+	const size_t baseline_cases =
+		baseline.value("cases_per_language", options.cases_per_language);
+	const size_t baseline_frames = baseline.value("frames_per_case", options.frames_per_case);
+	if (baseline_cases != options.cases_per_language ||
+	    baseline_frames != options.frames_per_case) {
+		fprintf(stderr, "The baseline was recorded with a different number of cases\n");
+		return 1;
+	}
+	// a baseline without measured results would pass any run
+	if (!baseline["results"].is_array() || baseline["results"].empty() ||
+	    std::any_of(baseline["results"].begin(), baseline["results"].end(),
+			[](const auto &r) {
+				return r.value("frames", 0) <= 0 ||
+				       r.value("ms_per_frame", 0.0) <= 0.0;
+			})) {
+		fprintf(stderr, "The baseline has no measured results, record it with "
+				"--write-baseline\n");
+		return 1;
+	}
+	auto result_key = [](const nlohmann::json &r) {
+		return config_key(r["language"].get<std::string>(),
+				  r["binarization_mode"].get<int>(),
+				  r["page_segmentation_mode"].get<int>());
+	};
+	int regressions = 0;
+	// a configuration that is not compared is a failure too, e.g. a missing model
+	for (const auto &actual : results) {
+		const std::string key = result_key(actual);
+		if (std::none_of(baseline["results"].begin(), baseline["results"].end(),
+				 [&](const auto &r) { return result_key(r) == key; })) {
+			fprintf(stderr, "MISSING %s: not in the baseline\n", key.c_str());
+			regressions++;
+		}
+	}
+	for (const auto &expected : baseline["results"]) {
+		const std::string key = result_key(expected);
+		auto actual = std::find_if(results.begin(), results.end(),
+					   [&](const auto &r) { return result_key(r) == key; });
+		if (actual == results.end()) {
+			fprintf(stderr, "MISSING %s: in the baseline but not run\n", key.c_str());
+			regressions++;
+			continue;
+		}
+		const double expected_cer = expected["cer"].get<double>();
+		const double actual_cer = (*actual)["cer"].get<double>();
+		if (actual_cer > expected_cer + options.cer_tolerance) {
+			fprintf(stderr, "REGRESSION %s: cer %.4f > baseline %.4f\n", key.c_str(),
+				actual_cer, expected_cer);
+			regressions++;
+		}
+		const double expected_ms = expected["ms_per_frame"].get<double>();
+		const double actual_ms = (*actual)["ms_per_frame"].get<double>();
+		if (options.time_tolerance > 0 &&
+		    actual_ms > expected_ms * (1.0 + options.time_tolerance)) {
+			fprintf(stderr, "REGRESSION %s: %.2f ms/frame > baseline %.2f ms/frame\n",
+				key.c_str(), actual_ms, expected_ms);
+			regressions++;
+		}
+	}
+	printf("%d regression(s) or missing configuration(s) against %s\n", regressions,
+	       options.baseline_path.c_str());
+	return regressions == 0 ? 0 : 1;
+}
+
+int run_rescale_comparison(const synthetic_suite_options &options,
+			   const ocr_pipeline_settings &base_settings)
+{
+	cv::RNG rng(0x0C5);
+	printf("%-12s %-8s %8s %10s %12s\n", "language", "resize", "cer", "resize_ms",
+	       "diff_vs_area");
+	for (const auto &samples : SAMPLES) {
+		const std::string traineddata = options.tessdata_path + "/" + samples.language +
+						".traineddata";
+		if (!std::filesystem::exists(traineddata)) {
+			continue;
+		}
+		std::unique_ptr<tesseract::TessBaseAPI> model(create_tesseract_model(
+			options.tessdata_path.c_str(), samples.language, nullptr, 0));
+		ocr_pipeline_settings settings = base_settings;
+		settings.language = samples.language;
+		// the frames are given to the pipeline already rescaled
+		settings.rescaleImage = false;
+		apply_tesseract_settings(model.get(), settings.pageSegmentationMode,
+					 settings.char_whitelist);
+
+		double total_cer[std::size(INTERPOLATIONS)] = {0};
+		uint64_t total_resize_ns[std::size(INTERPOLATIONS)] = {0};
+		double total_diff[std::size(INTERPOLATIONS)] = {0};
+		size_t frame_count = 0;
+		for (size_t variant = 0; variant < options.cases_per_language; variant++) {
+			const std::string truth = samples.texts[variant % samples.texts.size()];
+			for (size_t frame = 0; frame < options.frames_per_case; frame++) {
+				cv::Mat source;
+				cv::resize(render_frame(truth, variant, frame, rng), source,
+					   cv::Size(), options.rescale_compare_upscale,
+					   options.rescale_compare_upscale, cv::INTER_CUBIC);
+				const double scale = (double)base_settings.rescaleTargetSize /
+						     (double)source.rows;
+				const cv::Size target(
+					std::max(1, (int)std::lround(source.cols * scale)),
+					base_settings.rescaleTargetSize);
+
+				cv::Mat rescaled[std::size(INTERPOLATIONS)];
+				for (size_t i = 0; i < std::size(INTERPOLATIONS); i++) {
+					const uint64_t start_ns = get_time_ns();
+					cv::resize(source, rescaled[i], target, 0, 0,
+						   INTERPOLATIONS[i].flag);
+					total_resize_ns[i] += get_time_ns() - start_ns;
+					cv::Mat imageForOCR =
+						preprocess_image(rescaled[i], settings);
+					const std::string text = recognize_text(
+						model.get(), imageForOCR, settings.conf_threshold);
+					total_cer[i] += character_error_rate(truth, text);
+				}
+				for (size_t i = 0; i < std::size(INTERPOLATIONS); i++) {
+					// mean absolute difference per channel, 0-255
+					cv::Mat diff;
+					cv::absdiff(rescaled[i], rescaled[AREA_INTERPOLATION],
+						    diff);
+					const cv::Scalar mean = cv::mean(diff);
+					total_diff[i] += (mean[0] + mean[1] + mean[2]) / 3.0;
+				}
+				frame_count++;
+			}
+		}
+		for (size_t i = 0; i < std::size(INTERPOLATIONS); i++) {
+			const double count = frame_count ? (double)frame_count : 1.0;
+			const double cer = total_cer[i] / count;
+			const double resize_ms = (double)total_resize_ns[i] / 1e6 / count;
+			const double diff = total_diff[i] / count;
+			printf("%-12s %-8s %8.4f %10.3f %12.2f\n", samples.language,
+			       INTERPOLATIONS[i].name, cer, resize_ms, diff);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef SYNTHETIC_SUITE_H
+#define SYNTHETIC_SUITE_H
+
+#include "ocr-pipeline.h"
+
+#include <string>
+
+struct synthetic_suite_options {
+	std::string tessdata_path;
+	// baseline to compare against, if any
+	std::string baseline_path;
+	// where to write the results of this run as a new baseline, if any
+	std::string write_baseline_path;
+	// allowed absolute increase in character error rate before failing
+	double cer_tolerance = 0.01;
+	// allowed relative increase in time per frame before failing, 0 disables the check
+	double time_tolerance = 0.0;
+	size_t cases_per_language = 12;
+	size_t frames_per_case = 3;
+	// compare rescale interpolations instead of binarization modes
+	bool rescale_compare = false;
+	// how much larger than rendered the frames are before rescaling, like a full HD source
+	double rescale_compare_upscale = 4.0;
+};
+
+/**
+  * @brief Run the synthetic accuracy and speed suite.
+  *
+  * Renders frames with known text, runs them through the pipeline under every binarization
+  * mode and a set of page segmentation modes, and records the character error rate and the
+  * time per frame. Settings other than binarization mode and PSM come from base_settings.
+  *
+  * Every configuration run must be in the baseline and every configuration of the baseline
+  * must run (e.g. its model must be in the tessdata folder), otherwise the gate fails.
+  *
+  * @return 0 on success, 1 if the results regress against the baseline or do not cover it
+*/
+int run_synthetic_suite(const synthetic_suite_options &options,
+			const ocr_pipeline_settings &base_settings);
+
+/**
+  * @brief Compare the interpolations a frame can be rescaled with before OCR.
+  *
+  * Renders the same frames, enlarges them to the size of a typical source and downscales them
+  * to base_settings.rescaleTargetSize with bilinear interpolation (the CPU rescale and the
+  * bilinear GPU rescale) and with area interpolation (the area GPU rescale), then reports the
+  * character error rate, the resize time and how much the downscaled images differ.
+  *
+  * @return 0
+*/
+int run_rescale_comparison(const synthetic_suite_options &options,
+			   const ocr_pipeline_settings &base_settings);
+
+double character_error_rate(const std::string &truth, const std::string &recognized);
+
+#endif /* SYNTHETIC_SUITE_H */
@@ -0,0 +1,112 @@
+#include "box-tracker.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+
+namespace {
+
+// match score below which a box counts as lost
+const double MIN_MATCH_SCORE = 0.7;
+// a flat patch matches anywhere, boxes without texture are not tracked
+const double MIN_PATCH_STDDEV = 4.0;
+// gray levels a pixel must change by to count towards new content, above capture noise
+const double CHANGE_LEVEL = 32.0;
+
+// how far a box is searched for around its last position, in pixels
+int search_margin(const cv::Rect &box)
+{
+	return std::clamp(box.height / 2, 4, 32);
+}
+
+} // namespace
+
+void box_tracker::clear()
+{
+	tracked.clear();
+	previous.release();
+}
+
+void box_tracker::reset(const cv::Mat &gray, const std::vector<OCRBox> &boxes)
+{
+	clear();
+	const cv::Rect frame(cv::Point(0, 0), gray.size());
+	for (const auto &box : boxes) {
+		const cv::Rect inside = box.box & frame;
+		if (inside.width < 4 || inside.height < 4) {
+			continue;
+		}
+		cv::Scalar mean, stddev;
+		cv::meanStdDev(gray(inside), mean, stddev);
+		if (stddev[0] < MIN_PATCH_STDDEV) {
+			continue;
+		}
+		tracked.push_back({{box.text, inside}, gray(inside).clone()});
+	}
+	// the frame is only read, no need to copy it
+	previous = gray;
+}
+
+box_tracking_result box_tracker::track(const cv::Mat &gray, int change_threshold)
+{
+	box_tracking_result result;
+	if (gray.size() != previous.size() || tracked.empty()) {
+		return result;
+	}
+	const cv::Rect frame(cv::Point(0, 0), gray.size());
+
+	// pixels that changed since the previous frame, the boxes are cleared from it below
+	cv::Mat changed;
+	cv::absdiff(gray, previous, changed);
+	cv::threshold(changed, changed, CHANGE_LEVEL, 255, cv::THRESH_BINARY);
+
+	result.tracked = true;
+	result.min_score = 1.0f;
+	cv::Mat scores;
+	for (auto &entry : tracked) {
+		cv::Rect &box = entry.box.box;
+		cv::rectangle(changed, box, cv::Scalar(0), cv::FILLED);
+		const int margin = search_margin(box);
+		const cv::Rect window =
+			cv::Rect(box.x - margin, box.y - margin, box.width + 2 * margin,
+				 box.height + 2 * margin) &
+			frame;
+		if (window.width < box.width || window.height < box.height) {
+			result.tracked = false;
+			result.min_score = 0.0f;
+			continue;
+		}
+		cv::matchTemplate(gray(window), entry.patch, scores, cv::TM_CCOEFF_NORMED);
+		double best_score = 0.0;
+		cv::Point best;
+		cv::minMaxLoc(scores, nullptr, &best_score, nullptr, &best);
+		result.min_score = std::min(result.min_score, (float)best_score);
+		if (best_score < MIN_MATCH_SCORE) {
+			result.tracked = false;
+			continue;
+		}
+		const cv::Point position = window.tl() + best;
+		if (position != box.tl()) {
+			box.x = position.x;
+			box.y = position.y;
+			result.moved = true;
+		}
+		cv::rectangle(changed, box, cv::Scalar(0), cv::FILLED);
+	}
+
+	const double frame_area = (double)gray.cols * gray.rows;
+	result.new_content = cv::countNonZero(changed) >= change_threshold / 100.0 * frame_area;
+	previous = gray;
+	return result;
+}
+
+std::vector<OCRBox> box_tracker::boxes() const
+{
+	std::vector<OCRBox> boxes;
+	boxes.reserve(tracked.size());
+	for (const auto &entry : tracked) {
+		boxes.push_back(entry.box);
+	}
+	return boxes;
+}
@@ -0,0 +1,60 @@
+#ifndef BOX_TRACKER_H
+#define BOX_TRACKER_H
+
+// Moves the text boxes of the last recognition along with the text on every captured frame,
+// so box outputs follow the text at frame rate while OCR runs only when the boxes are lost or
+// new content appears. Free of OBS types.
+
+#include "ocr-pipeline.h"
+
+#include <opencv2/core/mat.hpp>
+
+#include <vector>
+
+struct box_tracking_result {
+	// every box was found again in the frame
+	bool tracked = false;
+	// at least one box moved since the previous frame
+	bool moved = false;
+	// enough pixels changed outside the boxes for new text to have appeared
+	bool new_content = false;
+	// the lowest match score of the boxes, 1 for a perfect match
+	float min_score = 0.0f;
+};
+
+/**
+  * @brief Template tracking of text boxes between recognitions.
+  *
+  * Each box keeps its patch of the frame it was recognized in, and is searched for in a window
+  * around its last position with normalized cross-correlation. The patch is not updated, so
+  * text that changes in place (e.g. a score) makes the match fail and OCR run again.
+*/
+class box_tracker {
+public:
+	bool empty() const { return tracked.empty(); }
+	void clear();
+	// Start tracking boxes, in pixels of gray, found in the frame gray
+	void reset(const cv::Mat &gray, const std::vector<OCRBox> &boxes);
+
+	/**
+	  * @brief Find the boxes in the next frame.
+	  *
+	  * @param gray  The frame, the same size as the one given to reset
+	  * @param change_threshold  Percent of the frame outside the boxes that must change to
+	  * count as new content
+	*/
+	box_tracking_result track(const cv::Mat &gray, int change_threshold);
+
+	// The boxes at their tracked positions
+	std::vector<OCRBox> boxes() const;
+
+private:
+	struct tracked_box {
+		OCRBox box;
+		cv::Mat patch;
+	};
+	std::vector<tracked_box> tracked;
+	cv::Mat previous;
+};
+
+#endif /* BOX_TRACKER_H */
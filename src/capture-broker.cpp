@@ -0,0 +1,127 @@
+#include "capture-broker.h"
+#include "obs-utils.h"
+
+#include <obs-module.h>
+
+#include <cstring>
+#include <map>
+
+namespace {
+
+struct source_capture {
+	size_t filters = 0;
+	// the last published frame, at the size of the source
+	cv::Mat frame;
+	uint64_t frame_time_ns = 0;
+	cv::Size source_size;
+};
+
+std::mutex broker_mutex;
+// keyed by the source whose output the filters read, which is never dereferenced here
+std::map<const obs_source_t *, source_capture> captures;
+
+/**
+  * @brief The source whose output the filter's target draws unchanged.
+  *
+  * The target is the filter before this one on the source, or the source itself. OCR filters
+  * that drew their own target as is on their last render, without redaction or a preview, are
+  * skipped, so the filters of a run of them read the same frame. Any other filter in between
+  * gives the filters different captures.
+*/
+const obs_source_t *capture_source(filter_data *tf)
+{
+	obs_source_t *target = obs_filter_get_target(tf->source);
+	while (target != nullptr && obs_source_get_type(target) == OBS_SOURCE_TYPE_FILTER &&
+	       strcmp(obs_source_get_id(target), "ocr_filter") == 0) {
+		const filter_data *upstream =
+			reinterpret_cast<const filter_data *>(obs_obj_get_data(target));
+		if (obs_source_enabled(target) &&
+		    (upstream == nullptr || !upstream->outputUnchanged)) {
+			break;
+		}
+		target = obs_filter_get_target(target);
+	}
+	return target;
+}
+
+// with broker_mutex held
+void detach_locked(filter_data *tf)
+{
+	auto it = captures.find(tf->captureTarget);
+	if (it != captures.end() && --it->second.filters == 0) {
+		captures.erase(it);
+	} else if (it != captures.end() && it->second.filters == 1) {
+		// the last filter stages on its own again, do not hold the frame for it
+		it->second.frame.release();
+	}
+	tf->captureTarget = nullptr;
+}
+
+} // namespace
+
+bool capture_broker_update(filter_data *tf, bool gpu_capture)
+{
+	const obs_source_t *target = gpu_capture ? capture_source(tf) : nullptr;
+
+	std::lock_guard<std::mutex> lock(broker_mutex);
+	if (target != tf->captureTarget) {
+		detach_locked(tf);
+		if (target != nullptr) {
+			captures[target].filters++;
+			tf->captureTarget = target;
+		}
+	}
+	auto it = captures.find(target);
+	tf->captureShared = it != captures.end() && it->second.filters > 1;
+	return tf->captureShared;
+}
+
+void capture_broker_detach(filter_data *tf)
+{
+	std::lock_guard<std::mutex> lock(broker_mutex);
+	detach_locked(tf);
+	tf->captureShared = false;
+}
+
+bool capture_broker_take(filter_data *tf, uint64_t frame_time_ns, cv::Size source_size)
+{
+	// the filters before this one rendered since capture_broker_update, one of them may
+	// have started to redact its output
+	if (capture_source(tf) != tf->captureTarget) {
+		tf->captureShared = false;
+		return false;
+	}
+	cv::Mat frame;
+	{
+		std::lock_guard<std::mutex> lock(broker_mutex);
+		auto it = captures.find(tf->captureTarget);
+		if (it == captures.end() || it->second.frame.empty() ||
+		    it->second.frame_time_ns != frame_time_ns) {
+			return false;
+		}
+		if (it->second.source_size != source_size) {
+			// the boxes would be scaled to the wrong size, and a frame of this size
+			// would replace the other filters' frame
+			tf->captureShared = false;
+			return false;
+		}
+		frame = it->second.frame;
+	}
+	// a reference, the buffer is shared with the filter that staged it
+	storeInputFrame(tf, frame, frame_time_ns, true, source_size);
+	tf->counters.shared_captures.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+void capture_broker_publish(filter_data *tf, const cv::Mat &frame, uint64_t frame_time_ns,
+			    cv::Size source_size)
+{
+	std::lock_guard<std::mutex> lock(broker_mutex);
+	auto it = captures.find(tf->captureTarget);
+	if (it == captures.end()) {
+		return;
+	}
+	it->second.frame = frame;
+	it->second.frame_time_ns = frame_time_ns;
+	it->second.source_size = source_size;
+}
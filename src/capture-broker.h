@@ -0,0 +1,42 @@
+#ifndef CAPTURE_BROKER_H
+#define CAPTURE_BROKER_H
+
+// One readback per frame for all the OCR filters that read the same frame. The first filter to
+// stage a frame publishes it, the others take a reference to the same buffer instead of
+// staging the source again. Filters read the same frame when only OCR filters that draw their
+// target unchanged are between them.
+
+#include "filter-data.h"
+
+/**
+  * @brief Register whether the filter captures its source on the GPU this frame.
+  *
+  * Called from video_render. Sets tf->captureShared when other OCR filters read the same frame
+  * of the same source. Shared frames are read back at full size, each filter takes its regions
+  * from them and rescales on the CPU.
+  *
+  * @param tf  The filter data
+  * @param gpu_capture  Whether the filter renders and stages its source
+  * @return true if the capture is shared with other filters
+*/
+bool capture_broker_update(filter_data *tf, bool gpu_capture);
+// Remove the filter from the broker, e.g. when it is destroyed
+void capture_broker_detach(filter_data *tf);
+
+/**
+  * @brief Give the filter the frame another filter staged for this frame.
+  *
+  * Clears tf->captureShared when the frame can no longer be shared, e.g. a filter before this
+  * one redacted its output after capture_broker_update, so the filter does not publish the
+  * frame it stages itself.
+  *
+  * @param source_size  The size of the filter's target, which the frame must have
+  * @return false if no filter staged this frame yet, or the filter must stage its own
+*/
+bool capture_broker_take(filter_data *tf, uint64_t frame_time_ns, cv::Size source_size);
+// Share a staged frame with the other filters on the source. The frame must not be written to
+// afterwards.
+void capture_broker_publish(filter_data *tf, const cv::Mat &frame, uint64_t frame_time_ns,
+			    cv::Size source_size);
+
+#endif /* CAPTURE_BROKER_H */
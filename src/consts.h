@@ -41,4 +41,8 @@ const int OUTPUT_IMAGE_OPTION_DETECTION_MASK = 0;
 const int OUTPUT_IMAGE_OPTION_TEXT_OVERLAY = 1;
 const int OUTPUT_IMAGE_OPTION_TEXT_BACKGROUND = 2;
 
+const int GPU_RESCALE_OFF = 0;
+const int GPU_RESCALE_BILINEAR = 1;
+const int GPU_RESCALE_AREA = 2;
+
 #endif /* CONSTS_H */
@@ -7,13 +7,25 @@
 
 #include <tesseract/baseapi.h>
 
+#include "ocr-stats.h"
+#include "frame-arena.h"
+#include "gpu-change-detection.h"
+#include "roi-atlas.h"
+#include "scroll-tracker.h"
+#include "box-tracker.h"
+#include "redaction.h"
+#include "gpu-redaction.h"
+
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <condition_variable>
-#include <string>
 
 class CharacterBasedSmoothingFilter;
+class frame_recorder;
+struct ocr_model;
 
 /**
   * @brief The filter_data struct
@@ -25,14 +37,72 @@ struct filter_data {
 	obs_source_t *source;
 	std::string unique_id;
 	gs_texrender_t *texrender;
+	// the target downscaled for OCR, see downscaleRenderedTarget
+	gs_texrender_t *rescaleTexrender = nullptr;
+	gpu_change_detection changeDetection;
+	// regions of interest in source pixels, empty for the whole source
+	std::mutex regionsLock;
+	std::vector<cv::Rect> regions;
+	bool regionsChanged = false;
+	std::atomic<bool> hasRegions{false};
+	// render thread: the regions packed for the current target size
+	roi_atlas atlas;
+	cv::Size atlasSourceSize;
+	gs_texrender_t *atlasTexrender = nullptr;
+	// recognize only what scrolled into view, see scroll-tracker.h
+	int scrollMode = SCROLL_MODE_OFF;
+	// OCR thread: the previous frames and text of scroll mode
+	scroll_tracker scroll;
+	// move the boxes with the text on every frame between recognitions
+	bool trackBoxes = false;
+	// hide the text that matches the redactor in the output, see redaction.h
+	int redactionMode = REDACTION_MODE_OFF;
+	// OCR thread: which boxes to redact, replaced under tesseract_settings_mutex
+	text_redactor redactor;
+	int redactionPadding = 4;
+	uint32_t redactionHoldMs = 1000;
+	// pixelation block size or blur width, in pixels
+	int redactionStrength = 16;
+	// the boxes being redacted, in source pixels, published by the OCR thread
+	std::mutex redactionLock;
+	redaction_hold redactionBoxes;
+	// render thread: the effect, and whether tf->texrender holds this frame's target
+	gpu_redaction redaction;
+	bool targetRendered = false;
+	// render thread: whether the last output was the target as is, read by the capture
+	// broker of the filters after this one
+	bool outputUnchanged = true;
+	// the source whose frames this filter captures through the capture broker, and whether
+	// other OCR filters capture them too
+	const obs_source_t *captureTarget = nullptr;
+	bool captureShared = false;
 	gs_stagesurf_t *stagesurface;
 	gs_effect_t *effect;
 
+	// buffers of the OCR thread, declared before the Mats so it outlives the ones it holds
+	frame_arena arena;
+	// OCR thread: the boxes of the last recognition, in pixels of the frame, with their
+	// patches of it
+	box_tracker tracker;
+	// BGRA, or only the luma when frames come from an async source
 	cv::Mat inputBGRA;
+	// OBS video time (os_gettime_ns clock) of the frame in inputBGRA
+	uint64_t inputTimestampNs = 0;
+	// size of the source inputBGRA was downscaled from, OCR results are scaled back to it
+	cv::Size inputSourceSize;
+	// where the regions are in inputBGRA if it is a regions atlas
+	roi_atlas inputAtlas;
+	// inputBGRA was taken by reference (by the OCR thread or another filter), write the next
+	// frame to a new buffer
+	bool inputBGRAShared = false;
 	cv::Mat lastInputBGRA;
-	cv::Mat outputPreviewBGRA;
+	// the image given to OCR, grayscale once binarized. The sequence counts new previews.
+	cv::Mat outputPreview;
+	uint64_t outputPreviewSequence = 0;
+	// render thread: a dynamic texture, updated when the sequence moves past the uploaded one
 	gs_texture_t *outputPreviewTexture = nullptr;
-	tesseract::TessBaseAPI *tesseract_model;
+	uint64_t outputPreviewUploaded = 0;
+	std::shared_ptr<ocr_model> tesseract_model;
 	std::string language;
 	int pageSegmentationMode;
 	int binarizationMode;
@@ -42,6 +112,7 @@ struct filter_data {
 	int dilationIterations;
 	bool rescaleImage;
 	int rescaleTargetSize;
+	int gpuRescale = 0;
 	std::string char_whitelist;
 	std::string user_patterns;
 	int conf_threshold;
@@ -56,11 +127,44 @@ struct filter_data {
 	int output_image_option;
 	bool output_file_append;
 	bool output_flatten;
+	bool trace_enabled = false;
+	bool trace_rolling = false;
+	bool record_frames = false;
+	uint32_t record_max_frames = 300;
+	std::unique_ptr<frame_recorder> recorder;
+	// time from frame capture to the sinks being updated with its result
+	latency_histogram capture_to_output_latency;
+	frame_counters counters;
+	memory_usage memory;
+	// seconds a deactivated filter keeps its model and buffers, 0 to keep them
+	uint32_t idle_unload_seconds = 60;
+	// time from activation to the model being loaded again after an idle unload
+	std::atomic<uint64_t> activated_at_ns{0};
+	latency_histogram model_warmup;
+	std::atomic<uint64_t> model_unloads{0};
 
-	bool isDisabled;
+	std::atomic<bool> isDisabled{false};
+	// shown anywhere, e.g. in the studio mode preview or a projector, while isDisabled
+	// follows the program output
+	std::atomic<bool> isShown{false};
+	// OCR thread: when a model that failed to load is tried again, and the current delay,
+	// doubled on every failure. Reset when the settings change.
+	std::atomic<uint64_t> modelRetryAtNs{0};
+	uint64_t modelRetryDelayNs = 0;
+	// incremented for every frame staged into inputBGRA
+	std::atomic<uint64_t> inputFrameSequence{0};
+	// set while the OCR thread waits for a frame, the render thread only wakes it up then
+	std::atomic<bool> waitingForFrame{false};
+	// frames are taken on the CPU in filter_video, the GPU capture is not needed
+	std::atomic<bool> asyncFrameTap{false};
+	// frames come from the program output instead of the source, see program-capture.h
+	std::atomic<bool> programCapture{false};
+	uint32_t programCaptureWidth = 0;
+	uint32_t programCaptureHeight = 0;
+	uint32_t programCaptureDivisor = 1;
 
 	std::mutex inputBGRALock;
-	std::mutex outputPreviewBGRALock;
+	std::mutex outputPreviewLock;
 	std::mutex tesseract_mutex;
 	std::mutex tesseract_settings_mutex;
 	bool tesseract_thread_run;
@@ -0,0 +1,312 @@
+#include "frame-arena.h"
+
+#include <opencv2/core.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <map>
+
+namespace {
+
+thread_local frame_arena *current_arena = nullptr;
+
+// whether the dispatcher is OpenCV's default allocator, and the one it replaced
+std::atomic<bool> dispatcher_installed{false};
+std::atomic<cv::MatAllocator *> replaced_default{nullptr};
+std::mutex install_mutex;
+
+/**
+  * @brief OpenCV's default allocator once an arena is used: allocations of a thread inside a
+  * frame_arena_scope go to its arena, all others to the allocator it replaced.
+  *
+  * The UMatData of an allocation remembers the allocator that made it, so deallocation goes
+  * straight back there and never through this class.
+*/
+class thread_arena_dispatcher : public cv::MatAllocator {
+public:
+	cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+			       cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override
+	{
+		const cv::MatAllocator *target = current_arena;
+		if (target == nullptr) {
+			target = replaced_default.load(std::memory_order_acquire);
+		}
+		if (target == nullptr) {
+			target = cv::Mat::getStdAllocator();
+		}
+		return target->allocate(dims, sizes, type, data, step, flags, usageFlags);
+	}
+
+	bool allocate(cv::UMatData *data, cv::AccessFlag accessflags,
+		      cv::UMatUsageFlags usageFlags) const override
+	{
+		return cv::Mat::getStdAllocator()->allocate(data, accessflags, usageFlags);
+	}
+
+	void deallocate(cv::UMatData *data) const override
+	{
+		cv::Mat::getStdAllocator()->deallocate(data);
+	}
+};
+
+thread_arena_dispatcher dispatcher;
+
+void install_dispatcher()
+{
+	if (dispatcher_installed.load(std::memory_order_acquire)) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(install_mutex);
+	if (!dispatcher_installed.load(std::memory_order_relaxed)) {
+		replaced_default.store(cv::Mat::getDefaultAllocator(), std::memory_order_release);
+		cv::Mat::setDefaultAllocator(&dispatcher);
+		dispatcher_installed.store(true, std::memory_order_release);
+	}
+}
+
+} // namespace
+
+/**
+  * @brief The buffers of one arena.
+  *
+  * UMatData keeps a pointer to the allocator that made it, so the pool is a separate object:
+  * when the arena is destroyed while buffers are still in use (e.g. members of the filter
+  * destroyed after it), the pool is detached, frees the remaining buffers as they are
+  * released and deletes itself with the last one.
+*/
+class frame_arena::pool : public cv::MatAllocator {
+public:
+	cv::UMatData *allocate(int dims, const int *sizes, int type, void *data0, size_t *step,
+			       cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override
+	{
+		if (data0 != nullptr) {
+			// wrapping user memory, nothing to recycle
+			return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data0, step,
+								    flags, usageFlags);
+		}
+
+		// same layout as OpenCV's standard allocator
+		size_t total = CV_ELEM_SIZE(type);
+		for (int i = dims - 1; i >= 0; i--) {
+			if (step) {
+				step[i] = total;
+			}
+			total *= sizes[i];
+		}
+
+		uchar *data = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			allocation_count++;
+			auto it = free_blocks.find(total);
+			if (it != free_blocks.end()) {
+				data = it->second.data;
+				free_blocks.erase(it);
+				bytes_pooled -= total;
+				reused_count++;
+			}
+			bytes_in_use += total;
+			buffers_in_use++;
+		}
+		if (data == nullptr) {
+			data = (uchar *)cv::fastMalloc(total);
+		}
+
+		cv::UMatData *u = new cv::UMatData(this);
+		u->data = u->origdata = data;
+		u->size = total;
+		return u;
+	}
+
+	bool allocate(cv::UMatData *data, cv::AccessFlag, cv::UMatUsageFlags) const override
+	{
+		return data != nullptr;
+	}
+
+	void deallocate(cv::UMatData *u) const override
+	{
+		if (u == nullptr) {
+			return;
+		}
+		CV_Assert(u->urefcount == 0);
+		CV_Assert(u->refcount == 0);
+		bool last_of_detached = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			bytes_in_use -= u->size;
+			buffers_in_use--;
+			if (detached) {
+				cv::fastFree(u->origdata);
+				last_of_detached = buffers_in_use == 0;
+			} else {
+				free_blocks.insert({u->size, {u->origdata, iteration}});
+				bytes_pooled += u->size;
+			}
+		}
+		u->origdata = nullptr;
+		delete u;
+		if (last_of_detached) {
+			detached_count--;
+			delete this;
+		}
+	}
+
+	// Called by the arena's destructor, deletes the pool unless buffers are still in use
+	void detach()
+	{
+		bool in_use;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			free_released_before(UINT64_MAX);
+			in_use = buffers_in_use > 0;
+			detached = in_use;
+		}
+		if (in_use) {
+			detached_count++;
+		} else {
+			delete this;
+		}
+	}
+
+	// with the mutex held
+	void free_released_before(uint64_t before_iteration)
+	{
+		for (auto it = free_blocks.begin(); it != free_blocks.end();) {
+			if (it->second.released_iteration < before_iteration) {
+				cv::fastFree(it->second.data);
+				bytes_pooled -= it->first;
+				it = free_blocks.erase(it);
+			} else {
+				++it;
+			}
+		}
+		if (before_iteration == iteration) {
+			iteration++;
+		}
+	}
+
+	struct free_block {
+		uchar *data;
+		uint64_t released_iteration;
+	};
+
+	mutable std::mutex mutex;
+	mutable std::multimap<size_t, free_block> free_blocks;
+	mutable uint64_t iteration = 0;
+	mutable uint64_t allocation_count = 0;
+	mutable uint64_t reused_count = 0;
+	mutable uint64_t bytes_in_use = 0;
+	mutable uint64_t bytes_pooled = 0;
+	mutable uint64_t buffers_in_use = 0;
+	mutable bool detached = false;
+
+	static std::atomic<uint64_t> detached_count;
+};
+
+std::atomic<uint64_t> frame_arena::pool::detached_count{0};
+
+frame_arena::frame_arena() : buffers(new pool()) {}
+
+frame_arena::~frame_arena()
+{
+	buffers->detach();
+}
+
+cv::UMatData *frame_arena::allocate(int dims, const int *sizes, int type, void *data,
+				    size_t *step, cv::AccessFlag flags,
+				    cv::UMatUsageFlags usageFlags) const
+{
+	return buffers->allocate(dims, sizes, type, data, step, flags, usageFlags);
+}
+
+bool frame_arena::allocate(cv::UMatData *data, cv::AccessFlag accessflags,
+			   cv::UMatUsageFlags usageFlags) const
+{
+	return buffers->allocate(data, accessflags, usageFlags);
+}
+
+void frame_arena::deallocate(cv::UMatData *u) const
+{
+	// buffers remember the pool that made them, this is only reached through the arena
+	buffers->deallocate(u);
+}
+
+void frame_arena::end_iteration()
+{
+	std::lock_guard<std::mutex> lock(buffers->mutex);
+	buffers->free_released_before(buffers->iteration);
+}
+
+void frame_arena::trim()
+{
+	std::lock_guard<std::mutex> lock(buffers->mutex);
+	buffers->free_released_before(UINT64_MAX);
+}
+
+uint64_t frame_arena::allocations() const
+{
+	std::lock_guard<std::mutex> lock(buffers->mutex);
+	return buffers->allocation_count;
+}
+
+uint64_t frame_arena::reused() const
+{
+	std::lock_guard<std::mutex> lock(buffers->mutex);
+	return buffers->reused_count;
+}
+
+uint64_t frame_arena::pooled_bytes() const
+{
+	std::lock_guard<std::mutex> lock(buffers->mutex);
+	return buffers->bytes_pooled;
+}
+
+uint64_t frame_arena::in_use_bytes() const
+{
+	std::lock_guard<std::mutex> lock(buffers->mutex);
+	return buffers->bytes_in_use;
+}
+
+std::string frame_arena::summary() const
+{
+	std::lock_guard<std::mutex> lock(buffers->mutex);
+	const uint64_t allocation_count = buffers->allocation_count;
+	const uint64_t reused_count = buffers->reused_count;
+	char buffer[160];
+	snprintf(buffer, sizeof(buffer),
+		 "allocations=%llu reused=%llu (%.0f%%) in_use=%.1fMB pooled=%.1fMB",
+		 (unsigned long long)allocation_count, (unsigned long long)reused_count,
+		 allocation_count ? 100.0 * (double)reused_count / (double)allocation_count : 0.0,
+		 (double)buffers->bytes_in_use / (1024.0 * 1024.0),
+		 (double)buffers->bytes_pooled / (1024.0 * 1024.0));
+	return buffer;
+}
+
+uint64_t frame_arena::detached_pools()
+{
+	return pool::detached_count.load();
+}
+
+frame_arena_scope::frame_arena_scope(frame_arena &arena) : previous(current_arena)
+{
+	install_dispatcher();
+	current_arena = &arena;
+}
+
+frame_arena_scope::~frame_arena_scope()
+{
+	current_arena = previous;
+}
+
+void frame_arena_restore_default_allocator(void)
+{
+	std::lock_guard<std::mutex> lock(install_mutex);
+	if (!dispatcher_installed.load(std::memory_order_relaxed)) {
+		return;
+	}
+	// unless something else replaced the dispatcher since, and restores it itself
+	if (cv::Mat::getDefaultAllocator() == &dispatcher) {
+		cv::Mat::setDefaultAllocator(replaced_default.load(std::memory_order_relaxed));
+	}
+	dispatcher_installed.store(false, std::memory_order_release);
+}
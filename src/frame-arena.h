@@ -0,0 +1,85 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+// Recycling of the cv::Mat buffers the OCR pipeline allocates on every iteration. Free of OBS
+// types.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Give OpenCV back the default allocator it had before the first frame_arena_scope, so no
+// allocation reaches the plugin after it unloads. Call once no OCR thread is running.
+void frame_arena_restore_default_allocator(void);
+
+#ifdef __cplusplus
+}
+
+#include <opencv2/core/mat.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/**
+  * @brief Allocator that recycles the per-iteration cv::Mat buffers of one OCR thread.
+  *
+  * Released buffers go to a free list keyed by size and are handed out again on the next
+  * iteration, which in steady state allocates the same sizes. end_iteration frees the buffers
+  * that were not reused since the previous call, so the pool follows the working set.
+  * Buffers may outlive an iteration (e.g. the change reference or the preview) and may be
+  * released from any thread. They may also outlive the arena: its pool stays alive until the
+  * last of them is released, and frees them directly from then on.
+*/
+class frame_arena : public cv::MatAllocator {
+public:
+	frame_arena();
+	~frame_arena() override;
+	frame_arena(const frame_arena &) = delete;
+	frame_arena &operator=(const frame_arena &) = delete;
+
+	cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step,
+			       cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+	bool allocate(cv::UMatData *data, cv::AccessFlag accessflags,
+		      cv::UMatUsageFlags usageFlags) const override;
+	void deallocate(cv::UMatData *data) const override;
+
+	void end_iteration();
+	// Free all pooled buffers, e.g. when the worker goes idle
+	void trim();
+
+	uint64_t allocations() const;
+	// allocations served from the free list
+	uint64_t reused() const;
+	uint64_t pooled_bytes() const;
+	uint64_t in_use_bytes() const;
+	// e.g. "allocations=1200 reused=1188 (99%) in_use=24.9MB pooled=8.3MB"
+	std::string summary() const;
+
+	// Pools of destroyed arenas whose buffers are still in use, for tests
+	static uint64_t detached_pools();
+
+private:
+	class pool;
+	// the buffers are allocated from the pool, which is deleted with the last of them
+	pool *buffers;
+};
+
+/**
+  * @brief Routes the cv::Mat allocations of the current thread to an arena while in scope.
+  *
+  * Other threads keep using the standard OpenCV allocator.
+*/
+class frame_arena_scope {
+public:
+	explicit frame_arena_scope(frame_arena &arena);
+	~frame_arena_scope();
+	frame_arena_scope(const frame_arena_scope &) = delete;
+	frame_arena_scope &operator=(const frame_arena_scope &) = delete;
+
+private:
+	frame_arena *previous;
+};
+#endif
+
+#endif /* FRAME_ARENA_H */
@@ -0,0 +1,280 @@
+#include "frame-recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define FRAME_RECORDING_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+uint64_t align_up(uint64_t size)
+{
+	return (size + FRAME_RECORDING_ALIGNMENT - 1) / FRAME_RECORDING_ALIGNMENT *
+	       FRAME_RECORDING_ALIGNMENT;
+}
+
+bool seek_file(FILE *file, uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(file, (long long)offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+uint64_t slot_offset(const frame_recording_file_header &header, uint64_t slot)
+{
+	return (uint64_t)header.header_size + slot * (uint64_t)header.slot_size;
+}
+
+uint64_t steady_time_ns()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		       std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+// "recording.ocrrec" for segment 0, "recording-2.ocrrec" for segment 2
+std::string segment_file(const std::string &path, uint32_t segment)
+{
+	if (segment == 0) {
+		return path;
+	}
+	const size_t separator = path.find_last_of("/\\");
+	const size_t dot = path.find_last_of('.');
+	const size_t insert_at =
+		dot != std::string::npos && (separator == std::string::npos || dot > separator)
+			? dot
+			: path.size();
+	return path.substr(0, insert_at) + "-" + std::to_string(segment) + path.substr(insert_at);
+}
+
+bool is_valid_header(const frame_recording_file_header &header)
+{
+	return memcmp(header.magic, FRAME_RECORDING_MAGIC, sizeof(header.magic)) == 0 &&
+	       header.version == FRAME_RECORDING_VERSION && header.slot_count > 0 &&
+	       header.slot_size >= sizeof(frame_recording_slot_header) &&
+	       header.header_size >= sizeof(frame_recording_file_header);
+}
+
+} // namespace
+
+frame_recorder::frame_recorder(const std::string &path_, uint32_t max_frames_)
+	: path(path_),
+	  segment_path(path_),
+	  max_frames(std::max<uint32_t>(1, max_frames_))
+{
+}
+
+frame_recorder::~frame_recorder()
+{
+	if (file != nullptr) {
+		fclose(file);
+	}
+}
+
+void frame_recorder::flush()
+{
+	if (file != nullptr) {
+		fflush(file);
+	}
+	last_flush_ns = steady_time_ns();
+}
+
+bool frame_recorder::start(const cv::Mat &frame)
+{
+	if (file != nullptr) {
+		fclose(file);
+		file = nullptr;
+	}
+	if (segments == 0) {
+		// a new recording, the segments of an earlier one would be mistaken for its own
+		for (uint32_t segment = 1; segment < FRAME_RECORDING_MAX_SEGMENTS; segment++) {
+			remove(segment_file(path, segment).c_str());
+		}
+	}
+	segment_path = segment_file(path, segments % FRAME_RECORDING_MAX_SEGMENTS);
+	segments++;
+	file = fopen(segment_path.c_str(), "w+b");
+	if (file == nullptr) {
+		return false;
+	}
+
+	const uint64_t payload_size = (uint64_t)frame.cols * frame.rows * frame.channels();
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, FRAME_RECORDING_MAGIC, sizeof(header.magic));
+	header.version = FRAME_RECORDING_VERSION;
+	header.header_size = FRAME_RECORDING_ALIGNMENT;
+	header.slot_count = max_frames;
+	header.slot_size = (uint32_t)align_up(sizeof(frame_recording_slot_header) + payload_size);
+	header.width = (uint32_t)frame.cols;
+	header.height = (uint32_t)frame.rows;
+	header.channels = (uint32_t)frame.channels();
+	header.frames_written = 0;
+
+	std::vector<uint8_t> header_block(header.header_size, 0);
+	memcpy(header_block.data(), &header, sizeof(header));
+	if (fwrite(header_block.data(), 1, header_block.size(), file) != header_block.size()) {
+		fclose(file);
+		file = nullptr;
+		return false;
+	}
+	slot_buffer.assign(sizeof(frame_recording_slot_header) + payload_size, 0);
+	return true;
+}
+
+bool frame_recorder::write(const cv::Mat &frame, uint64_t timestamp_ns)
+{
+	if (frame.empty() || frame.depth() != CV_8U) {
+		return false;
+	}
+	if (file == nullptr || header.width != (uint32_t)frame.cols ||
+	    header.height != (uint32_t)frame.rows || header.channels != (uint32_t)frame.channels()) {
+		if (!start(frame)) {
+			return false;
+		}
+	}
+
+	frame_recording_slot_header slot_header{};
+	slot_header.sequence = header.frames_written;
+	slot_header.timestamp_ns = timestamp_ns;
+	slot_header.width = header.width;
+	slot_header.height = header.height;
+	slot_header.channels = header.channels;
+	slot_header.payload_size = (uint32_t)(slot_buffer.size() - sizeof(slot_header));
+	memcpy(slot_buffer.data(), &slot_header, sizeof(slot_header));
+
+	// pack the rows, the source may be a view with padding
+	const size_t row_size = (size_t)frame.cols * frame.channels();
+	uint8_t *payload = slot_buffer.data() + sizeof(slot_header);
+	for (int y = 0; y < frame.rows; y++) {
+		memcpy(payload + (size_t)y * row_size, frame.ptr(y), row_size);
+	}
+
+	const uint64_t slot = header.frames_written % header.slot_count;
+	if (!seek_file(file, slot_offset(header, slot)) ||
+	    fwrite(slot_buffer.data(), 1, slot_buffer.size(), file) != slot_buffer.size()) {
+		return false;
+	}
+
+	// publish the frame by updating the count in the file header
+	header.frames_written++;
+	if (!seek_file(file, 0) || fwrite(&header, 1, sizeof(header), file) != sizeof(header)) {
+		return false;
+	}
+	// flushing every frame would stall the OCR thread on the disk
+	if (steady_time_ns() - last_flush_ns >= FRAME_RECORDING_FLUSH_INTERVAL_NS) {
+		flush();
+	}
+	return true;
+}
+
+frame_recording_reader::~frame_recording_reader()
+{
+	close();
+}
+
+void frame_recording_reader::close()
+{
+#ifdef FRAME_RECORDING_MMAP
+	if (mapped != nullptr) {
+		munmap((void *)mapped, mapped_size);
+	}
+#endif
+	mapped = nullptr;
+	mapped_size = 0;
+	if (file != nullptr) {
+		fclose(file);
+		file = nullptr;
+	}
+}
+
+bool frame_recording_reader::open(const std::string &path)
+{
+	close();
+
+#ifdef FRAME_RECORDING_MMAP
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd >= 0) {
+		struct stat st;
+		if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(header)) {
+			void *addr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (addr != MAP_FAILED) {
+				mapped = (const uint8_t *)addr;
+				mapped_size = (size_t)st.st_size;
+			}
+		}
+		::close(fd);
+	}
+	if (mapped != nullptr) {
+		memcpy(&header, mapped, sizeof(header));
+		return is_valid_header(header);
+	}
+#endif
+
+	// no mmap available, fall back to reading slot by slot
+	file = fopen(path.c_str(), "rb");
+	if (file == nullptr || fread(&header, 1, sizeof(header), file) != sizeof(header)) {
+		close();
+		return false;
+	}
+	return is_valid_header(header);
+}
+
+size_t frame_recording_reader::frame_count() const
+{
+	return (size_t)std::min<uint64_t>(header.frames_written, header.slot_count);
+}
+
+bool frame_recording_reader::read_frame(size_t index, cv::Mat &frame, uint64_t &timestamp_ns)
+{
+	if (index >= frame_count()) {
+		return false;
+	}
+	// the oldest frame is right after the newest one once the ring has wrapped
+	const uint64_t first_slot = header.frames_written > header.slot_count
+					    ? header.frames_written % header.slot_count
+					    : 0;
+	const uint64_t slot = (first_slot + index) % header.slot_count;
+	const uint64_t offset = slot_offset(header, slot);
+
+	frame_recording_slot_header slot_header;
+	const uint8_t *payload = nullptr;
+	if (mapped != nullptr) {
+		if (offset + sizeof(slot_header) > mapped_size) {
+			return false;
+		}
+		memcpy(&slot_header, mapped + offset, sizeof(slot_header));
+		if (offset + sizeof(slot_header) + slot_header.payload_size > mapped_size) {
+			return false;
+		}
+		payload = mapped + offset + sizeof(slot_header);
+	} else {
+		if (!seek_file(file, offset) ||
+		    fread(&slot_header, 1, sizeof(slot_header), file) != sizeof(slot_header)) {
+			return false;
+		}
+		slot_buffer.resize(slot_header.payload_size);
+		if (fread(slot_buffer.data(), 1, slot_buffer.size(), file) != slot_buffer.size()) {
+			return false;
+		}
+		payload = slot_buffer.data();
+	}
+
+	if (slot_header.channels < 1 || slot_header.channels > 4 ||
+	    (uint64_t)slot_header.width * slot_header.height * slot_header.channels !=
+		    slot_header.payload_size) {
+		return false;
+	}
+	frame = cv::Mat((int)slot_header.height, (int)slot_header.width,
+			CV_8UC((int)slot_header.channels), (void *)payload);
+	timestamp_ns = slot_header.timestamp_ns;
+	return true;
+}
@@ -0,0 +1,107 @@
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+// Recording of the frames fed to the OCR pipeline, for reproducing production issues offline.
+//
+// File layout, all little-endian, every block aligned to FRAME_RECORDING_ALIGNMENT so the file
+// can be memory-mapped and each frame used in place:
+//   [file header][slot 0][slot 1]...[slot N-1]
+// Each slot holds a slot header followed by the raw, tightly packed pixel rows. Frames are
+// appended slot by slot; once all slots are used the oldest one is overwritten, which bounds
+// the file size to a ring of N frames.
+//
+// A file holds frames of one size. When the size changes the recording continues in a new
+// segment file, <name>-1.ocrrec, <name>-2.ocrrec and so on, so the frames before the change
+// are kept. The number of segments is bounded too, the oldest one is reused after the last.
+
+#include <opencv2/core/mat.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+const char FRAME_RECORDING_MAGIC[8] = {'O', 'C', 'R', 'R', 'E', 'C', '1', '\0'};
+const uint32_t FRAME_RECORDING_VERSION = 1;
+const uint32_t FRAME_RECORDING_ALIGNMENT = 4096;
+const uint32_t FRAME_RECORDING_MAX_SEGMENTS = 8;
+// how often the recording is flushed to disk while frames are written
+const uint64_t FRAME_RECORDING_FLUSH_INTERVAL_NS = 1000000000ULL;
+
+struct frame_recording_file_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t slot_count;
+	uint32_t slot_size;
+	uint32_t width;
+	uint32_t height;
+	uint32_t channels;
+	uint32_t reserved;
+	// total frames ever written, the newest frame is in slot (frames_written - 1) % slot_count
+	uint64_t frames_written;
+};
+
+struct frame_recording_slot_header {
+	uint64_t sequence;
+	uint64_t timestamp_ns;
+	uint32_t width;
+	uint32_t height;
+	uint32_t channels;
+	uint32_t payload_size;
+	uint8_t reserved[32];
+};
+
+class frame_recorder {
+public:
+	frame_recorder(const std::string &path, uint32_t max_frames);
+	~frame_recorder();
+	frame_recorder(const frame_recorder &) = delete;
+	frame_recorder &operator=(const frame_recorder &) = delete;
+
+	// Append a frame, 8-bit 1 to 4 channels. A frame of a different size starts the next
+	// segment file.
+	bool write(const cv::Mat &frame, uint64_t timestamp_ns);
+	// Write the frames still buffered to disk, also done when the recorder is destroyed
+	void flush();
+	// The file frames are written to, the path given or one of its segments
+	const std::string &get_path() const { return segment_path; }
+
+private:
+	bool start(const cv::Mat &frame);
+
+	std::string path;
+	std::string segment_path;
+	uint32_t max_frames;
+	// segments started so far, the current one is segments - 1
+	uint32_t segments = 0;
+	FILE *file = nullptr;
+	frame_recording_file_header header{};
+	std::vector<uint8_t> slot_buffer;
+	uint64_t last_flush_ns = 0;
+};
+
+class frame_recording_reader {
+public:
+	frame_recording_reader() = default;
+	~frame_recording_reader();
+	frame_recording_reader(const frame_recording_reader &) = delete;
+	frame_recording_reader &operator=(const frame_recording_reader &) = delete;
+
+	bool open(const std::string &path);
+	size_t frame_count() const;
+	// Frames are indexed oldest first. The returned Mat points into the mapped file (or an
+	// internal buffer) and is valid until the next call or until the reader is destroyed.
+	bool read_frame(size_t index, cv::Mat &frame, uint64_t &timestamp_ns);
+
+private:
+	void close();
+
+	frame_recording_file_header header{};
+	const uint8_t *mapped = nullptr;
+	size_t mapped_size = 0;
+	FILE *file = nullptr;
+	std::vector<uint8_t> slot_buffer;
+};
+
+#endif /* FRAME_RECORDER_H */
@@ -0,0 +1,164 @@
+#include "gpu-change-detection.h"
+#include "filter-data.h"
+#include "plugin-support.h"
+#include "ocr-trace.h"
+
+namespace {
+
+// each pass averages 8x8 texels
+const uint32_t REDUCTION = 8;
+
+uint32_t reduced_size(uint32_t size)
+{
+	return (size + REDUCTION - 1) / REDUCTION;
+}
+
+bool load_effect(gpu_change_detection &detection)
+{
+	if (detection.effect != nullptr) {
+		return true;
+	}
+	if (detection.unavailable) {
+		return false;
+	}
+	char *effect_path = obs_module_file("change-detect.effect");
+	char *error = nullptr;
+	detection.effect = gs_effect_create_from_file(effect_path, &error);
+	bfree(effect_path);
+	if (detection.effect == nullptr) {
+		obs_log(LOG_ERROR, "Failed to load the change detection effect: %s",
+			error ? error : "file not found");
+		bfree(error);
+		detection.unavailable = true;
+		return false;
+	}
+	return true;
+}
+
+// Average 8x8 texels of source into a texrender of an eighth of its size
+bool reduce_pass(gpu_change_detection &detection, const char *technique,
+		 gs_texrender_t *target, gs_texture_t *source, gs_texture_t *reference,
+		 uint32_t source_width, uint32_t source_height)
+{
+	const uint32_t width = reduced_size(source_width);
+	const uint32_t height = reduced_size(source_height);
+	gs_texrender_reset(target);
+	if (!gs_texrender_begin(target, width, height)) {
+		return false;
+	}
+	gs_ortho(0.0f, (float)width, 0.0f, (float)height, -100.0f, 100.0f);
+	gs_effect_set_texture(gs_effect_get_param_by_name(detection.effect, "image"), source);
+	if (reference != nullptr) {
+		gs_effect_set_texture(gs_effect_get_param_by_name(detection.effect, "reference"),
+				      reference);
+	}
+	struct vec2 texel_size;
+	vec2_set(&texel_size, 1.0f / (float)source_width, 1.0f / (float)source_height);
+	gs_effect_set_vec2(gs_effect_get_param_by_name(detection.effect, "texel_size"),
+			   &texel_size);
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+	while (gs_effect_loop(detection.effect, technique)) {
+		gs_draw_sprite(nullptr, 0, width, height);
+	}
+	gs_blend_state_pop();
+	gs_texrender_end(target);
+	return true;
+}
+
+} // namespace
+
+bool gpu_frame_unchanged(filter_data *tf, gs_texture_t *texture, uint32_t width,
+			 uint32_t height)
+{
+	gpu_change_detection &detection = tf->changeDetection;
+	if (texture == nullptr || detection.reference == nullptr ||
+	    gs_texture_get_width(detection.reference) != width ||
+	    gs_texture_get_height(detection.reference) != height || !load_effect(detection)) {
+		return false;
+	}
+
+	OCR_TRACE_SPAN("gpu_change_detection");
+	if (detection.diff == nullptr) {
+		detection.diff = gs_texrender_create(GS_R32F, GS_ZS_NONE);
+		detection.reduced = gs_texrender_create(GS_R32F, GS_ZS_NONE);
+	}
+	const uint32_t diff_width = reduced_size(width);
+	const uint32_t diff_height = reduced_size(height);
+	if (!reduce_pass(detection, "Diff", detection.diff, texture, detection.reference, width,
+			 height) ||
+	    !reduce_pass(detection, "Reduce", detection.reduced,
+			 gs_texrender_get_texture(detection.diff), nullptr, diff_width,
+			 diff_height)) {
+		return false;
+	}
+
+	const uint32_t reduced_width = reduced_size(diff_width);
+	const uint32_t reduced_height = reduced_size(diff_height);
+	if (detection.stagesurface &&
+	    (gs_stagesurface_get_width(detection.stagesurface) != reduced_width ||
+	     gs_stagesurface_get_height(detection.stagesurface) != reduced_height)) {
+		gs_stagesurface_destroy(detection.stagesurface);
+		detection.stagesurface = nullptr;
+	}
+	if (!detection.stagesurface) {
+		detection.stagesurface =
+			gs_stagesurface_create(reduced_width, reduced_height, GS_R32F);
+	}
+	gs_stage_texture(detection.stagesurface, gs_texrender_get_texture(detection.reduced));
+	uint8_t *data;
+	uint32_t linesize;
+	if (!gs_stagesurface_map(detection.stagesurface, &data, &linesize)) {
+		return false;
+	}
+	double changed = 0.0;
+	for (uint32_t y = 0; y < reduced_height; y++) {
+		const float *row = reinterpret_cast<const float *>(data + y * linesize);
+		for (uint32_t x = 0; x < reduced_width; x++) {
+			changed += row[x];
+		}
+	}
+	gs_stagesurface_unmap(detection.stagesurface);
+
+	const double changed_fraction = changed / (double)(reduced_width * reduced_height);
+	return changed_fraction * 100.0 < (double)tf->update_on_change_threshold;
+}
+
+void gpu_change_reference_update(filter_data *tf, gs_texture_t *texture, uint32_t width,
+				 uint32_t height)
+{
+	gpu_change_detection &detection = tf->changeDetection;
+	if (texture == nullptr || detection.unavailable) {
+		return;
+	}
+	if (detection.reference &&
+	    (gs_texture_get_width(detection.reference) != width ||
+	     gs_texture_get_height(detection.reference) != height)) {
+		gs_texture_destroy(detection.reference);
+		detection.reference = nullptr;
+	}
+	if (!detection.reference) {
+		detection.reference = gs_texture_create(width, height, GS_BGRA, 1, nullptr, 0);
+	}
+	gs_copy_texture(detection.reference, texture);
+}
+
+void gpu_change_detection_destroy(gpu_change_detection &detection)
+{
+	if (detection.effect) {
+		gs_effect_destroy(detection.effect);
+	}
+	if (detection.reference) {
+		gs_texture_destroy(detection.reference);
+	}
+	if (detection.diff) {
+		gs_texrender_destroy(detection.diff);
+	}
+	if (detection.reduced) {
+		gs_texrender_destroy(detection.reduced);
+	}
+	if (detection.stagesurface) {
+		gs_stagesurface_destroy(detection.stagesurface);
+	}
+	detection = gpu_change_detection();
+}
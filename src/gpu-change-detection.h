@@ -0,0 +1,46 @@
+#ifndef GPU_CHANGE_DETECTION_H
+#define GPU_CHANGE_DETECTION_H
+
+// Change detection on the GPU, so unchanged frames are not staged and read back at all.
+
+#include <obs-module.h>
+
+/**
+  * @brief GPU resources of the change detection of one filter. Used from the graphics thread
+  * only.
+*/
+struct gpu_change_detection {
+	gs_effect_t *effect = nullptr;
+	// the last staged frame, compared against the next ones
+	gs_texture_t *reference = nullptr;
+	// fraction of changed pixels per 8x8 block, then per 64x64 block
+	gs_texrender_t *diff = nullptr;
+	gs_texrender_t *reduced = nullptr;
+	gs_stagesurf_t *stagesurface = nullptr;
+	// the effect failed to load, detect changes on the CPU only
+	bool unavailable = false;
+};
+
+struct filter_data;
+
+/**
+  * @brief Compare the frame against the last staged one on the GPU.
+  *
+  * Only the reduced per-block fractions are read back, a few hundred values for a full HD
+  * frame. The fraction is approximate at the right and bottom edges of frames whose size is
+  * not a multiple of 64.
+  *
+  * @param tf  The filter data
+  * @param texture  The frame about to be staged
+  * @return true if less than update_on_change_threshold percent of the pixels changed, false
+  * if the frame changed or could not be compared
+*/
+bool gpu_frame_unchanged(filter_data *tf, gs_texture_t *texture, uint32_t width,
+			 uint32_t height);
+// Keep the staged frame as the reference for the next comparisons
+void gpu_change_reference_update(filter_data *tf, gs_texture_t *texture, uint32_t width,
+				 uint32_t height);
+// With the graphics context entered
+void gpu_change_detection_destroy(gpu_change_detection &detection);
+
+#endif /* GPU_CHANGE_DETECTION_H */
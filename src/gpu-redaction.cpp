@@ -0,0 +1,107 @@
+#include "gpu-redaction.h"
+#include "filter-data.h"
+#include "plugin-support.h"
+#include "ocr-trace.h"
+#include "redaction.h"
+
+namespace {
+
+bool load_effect(gpu_redaction &redaction)
+{
+	if (redaction.effect != nullptr) {
+		return true;
+	}
+	if (redaction.unavailable) {
+		return false;
+	}
+	char *effect_path = obs_module_file("redact.effect");
+	char *error = nullptr;
+	redaction.effect = gs_effect_create_from_file(effect_path, &error);
+	bfree(effect_path);
+	if (redaction.effect == nullptr) {
+		obs_log(LOG_ERROR, "Failed to load the redaction effect: %s",
+			error ? error : "file not found");
+		bfree(error);
+		redaction.unavailable = true;
+		return false;
+	}
+	return true;
+}
+
+// Without the effect the text must still not show: cover the boxes with black
+void draw_solid_boxes(const std::vector<cv::Rect> &boxes)
+{
+	gs_effect_t *solid = obs_get_base_effect(OBS_EFFECT_SOLID);
+	struct vec4 black;
+	vec4_set(&black, 0.0f, 0.0f, 0.0f, 1.0f);
+	gs_effect_set_vec4(gs_effect_get_param_by_name(solid, "color"), &black);
+	for (const auto &box : boxes) {
+		gs_matrix_push();
+		gs_matrix_translate3f((float)box.x, (float)box.y, 0.0f);
+		while (gs_effect_loop(solid, "Solid")) {
+			gs_draw_sprite(nullptr, 0, (uint32_t)box.width, (uint32_t)box.height);
+		}
+		gs_matrix_pop();
+	}
+}
+
+} // namespace
+
+void gpu_redaction_draw(filter_data *tf, gs_texture_t *texture, uint32_t width, uint32_t height,
+			const std::vector<cv::Rect> &boxes)
+{
+	if (boxes.empty() || texture == nullptr) {
+		return;
+	}
+	OCR_TRACE_SPAN("redaction");
+	// the output may have changed size since the boxes were found
+	const cv::Rect frame(0, 0, (int)width, (int)height);
+	std::vector<cv::Rect> visible;
+	visible.reserve(boxes.size());
+	for (const auto &box : boxes) {
+		const cv::Rect inside = box & frame;
+		if (!inside.empty()) {
+			visible.push_back(inside);
+		}
+	}
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+	gpu_redaction &redaction = tf->redaction;
+	if (!load_effect(redaction)) {
+		draw_solid_boxes(visible);
+		gs_blend_state_pop();
+		return;
+	}
+	// sampled and written in linear light, like the output drawn under the boxes
+	const bool previous_srgb = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(true);
+	gs_effect_set_texture_srgb(gs_effect_get_param_by_name(redaction.effect, "image"), texture);
+	struct vec2 texel_size;
+	vec2_set(&texel_size, 1.0f / (float)width, 1.0f / (float)height);
+	gs_effect_set_vec2(gs_effect_get_param_by_name(redaction.effect, "texel_size"),
+			   &texel_size);
+	gs_effect_set_float(gs_effect_get_param_by_name(redaction.effect, "block_size"),
+			    (float)tf->redactionStrength);
+	const char *technique = tf->redactionMode == REDACTION_MODE_BLUR ? "Blur" : "Pixelate";
+	for (const auto &box : visible) {
+		// the sprite covers the box and samples the same part of the texture
+		gs_matrix_push();
+		gs_matrix_translate3f((float)box.x, (float)box.y, 0.0f);
+		while (gs_effect_loop(redaction.effect, technique)) {
+			gs_draw_sprite_subregion(texture, 0, (uint32_t)box.x, (uint32_t)box.y,
+						 (uint32_t)box.width, (uint32_t)box.height);
+		}
+		gs_matrix_pop();
+	}
+	gs_enable_framebuffer_srgb(previous_srgb);
+	gs_blend_state_pop();
+}
+
+void gpu_redaction_destroy(gpu_redaction &redaction)
+{
+	if (redaction.effect) {
+		gs_effect_destroy(redaction.effect);
+	}
+	redaction = gpu_redaction();
+}
@@ -0,0 +1,37 @@
+#ifndef GPU_REDACTION_H
+#define GPU_REDACTION_H
+
+// Redaction of text boxes in the filter output, drawn on the GPU on every rendered frame.
+
+#include <obs-module.h>
+
+#include <opencv2/core/types.hpp>
+
+#include <vector>
+
+/**
+  * @brief GPU resources of the redaction of one filter. Used from the graphics thread only.
+*/
+struct gpu_redaction {
+	gs_effect_t *effect = nullptr;
+	// the effect failed to load, the boxes are covered with black instead
+	bool unavailable = false;
+};
+
+struct filter_data;
+
+/**
+  * @brief Pixelate or blur the boxes over the output drawn so far.
+  *
+  * @param tf  The filter data
+  * @param texture  The rendered target the boxes are sampled from
+  * @param width  The width of the output and the texture
+  * @param height  The height of the output and the texture
+  * @param boxes  The boxes to redact, in pixels of the texture
+*/
+void gpu_redaction_draw(filter_data *tf, gs_texture_t *texture, uint32_t width, uint32_t height,
+			const std::vector<cv::Rect> &boxes);
+// With the graphics context entered
+void gpu_redaction_destroy(gpu_redaction &redaction);
+
+#endif /* GPU_REDACTION_H */
@@ -0,0 +1,206 @@
+#include "model-pool.h"
+#include "ocr-pipeline.h"
+#include "ocr-stats.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <set>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+// loaded LSTM models take a few times the size of their traineddata file
+const uint64_t MODEL_MEMORY_FACTOR = 3;
+
+std::mutex pool_mutex;
+std::vector<std::weak_ptr<ocr_model>> pool;
+// preloaded models waiting to be taken over, and the keys still loading
+std::vector<std::shared_ptr<ocr_model>> preloaded;
+std::set<std::string> preloading;
+std::condition_variable preload_cv;
+
+std::string model_key(const char *tessdata_path, const std::string &language)
+{
+	return std::string(tessdata_path) + "|" + language;
+}
+
+// with pool_mutex held
+void register_model(const std::shared_ptr<ocr_model> &model)
+{
+	std::vector<std::weak_ptr<ocr_model>> alive;
+	for (const auto &entry : pool) {
+		if (!entry.expired()) {
+			alive.push_back(entry);
+		}
+	}
+	alive.push_back(model);
+	pool.swap(alive);
+}
+
+} // namespace
+
+ocr_model::ocr_model(tesseract::TessBaseAPI *api_, const std::string &language_,
+		     const std::string &key_, uint64_t estimated_bytes_)
+	: api(api_),
+	  language(language_),
+	  key(key_),
+	  estimated_bytes(estimated_bytes_)
+{
+	ocr_memory_adjust_total((int64_t)estimated_bytes);
+}
+
+ocr_model::~ocr_model()
+{
+	api->End();
+	delete api;
+	ocr_memory_adjust_total(-(int64_t)estimated_bytes);
+}
+
+uint64_t estimate_ocr_model_bytes(const char *tessdata_path, const std::string &language)
+{
+	uint64_t bytes = 0;
+	std::stringstream languages(language);
+	std::string single_language;
+	// multiple languages are joined with '+', e.g. "eng+fra"
+	while (std::getline(languages, single_language, '+')) {
+		std::error_code error;
+		const std::uintmax_t file_size = std::filesystem::file_size(
+			std::filesystem::path(tessdata_path) / (single_language + ".traineddata"),
+			error);
+		if (!error) {
+			bytes += (uint64_t)file_size * MODEL_MEMORY_FACTOR;
+		}
+	}
+	return bytes;
+}
+
+std::shared_ptr<ocr_model> acquire_ocr_model(const char *tessdata_path,
+					     const std::string &language, char **configs,
+					     int configs_size, bool share)
+{
+	const std::string key = configs_size == 0 ? model_key(tessdata_path, language)
+						  : std::string();
+	if (!key.empty()) {
+		std::unique_lock<std::mutex> lock(pool_mutex);
+		preload_cv.wait(lock, [&key] { return preloading.count(key) == 0; });
+		auto it = std::find_if(preloaded.begin(), preloaded.end(),
+				       [&key](const std::shared_ptr<ocr_model> &model) {
+					       return model->key == key;
+				       });
+		if (it != preloaded.end()) {
+			std::shared_ptr<ocr_model> model = *it;
+			preloaded.erase(it);
+			return model;
+		}
+	}
+	if (share && !key.empty()) {
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		for (const auto &entry : pool) {
+			std::shared_ptr<ocr_model> model = entry.lock();
+			if (model && model->key == key) {
+				return model;
+			}
+		}
+	}
+
+	// loading takes a while, do it without holding the pool
+	auto model = std::make_shared<ocr_model>(
+		create_tesseract_model(tessdata_path, language, configs, configs_size), language,
+		key, estimate_ocr_model_bytes(tessdata_path, language));
+
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	register_model(model);
+	return model;
+}
+
+bool preload_ocr_model(const char *tessdata_path, const std::string &language)
+{
+	const std::string key = model_key(tessdata_path, language);
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		if (preloading.count(key) > 0 ||
+		    std::any_of(preloaded.begin(), preloaded.end(),
+				[&key](const std::shared_ptr<ocr_model> &model) {
+					return model->key == key;
+				})) {
+			return true;
+		}
+		preloading.insert(key);
+	}
+
+	std::shared_ptr<ocr_model> model;
+	try {
+		model = std::make_shared<ocr_model>(
+			create_tesseract_model(tessdata_path, language, nullptr, 0), language, key,
+			estimate_ocr_model_bytes(tessdata_path, language));
+	} catch (const std::exception &) {
+		model.reset();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		preloading.erase(key);
+		if (model) {
+			preloaded.push_back(model);
+			register_model(model);
+		}
+	}
+	preload_cv.notify_all();
+	return model != nullptr;
+}
+
+size_t release_preloaded_ocr_models()
+{
+	std::vector<std::shared_ptr<ocr_model>> released;
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+		released.swap(preloaded);
+	}
+	// the models are destroyed here, outside the pool lock
+	return released.size();
+}
+
+uint64_t ocr_model_pool_bytes()
+{
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	uint64_t bytes = 0;
+	for (const auto &entry : pool) {
+		std::shared_ptr<ocr_model> model = entry.lock();
+		if (model) {
+			bytes += model->estimated_bytes;
+		}
+	}
+	return bytes;
+}
+
+std::string ocr_model_pool_summary()
+{
+	std::lock_guard<std::mutex> lock(pool_mutex);
+	std::string result;
+	char buffer[128];
+	for (const auto &entry : pool) {
+		std::shared_ptr<ocr_model> model = entry.lock();
+		if (!model) {
+			continue;
+		}
+		const bool is_preloaded =
+			std::find(preloaded.begin(), preloaded.end(), model) != preloaded.end();
+		// do not count the references taken here and by the preloaded list
+		const long users = model.use_count() - 1 - (is_preloaded ? 1 : 0);
+		if (is_preloaded) {
+			snprintf(buffer, sizeof(buffer), "%s%s (preloaded, ~%.1fMB)",
+				 result.empty() ? "" : ", ", model->language.c_str(),
+				 (double)model->estimated_bytes / (1024.0 * 1024.0));
+		} else {
+			snprintf(buffer, sizeof(buffer), "%s%s (%ld user%s, ~%.1fMB)",
+				 result.empty() ? "" : ", ", model->language.c_str(), users,
+				 users == 1 ? "" : "s",
+				 (double)model->estimated_bytes / (1024.0 * 1024.0));
+		}
+		result += buffer;
+	}
+	return result.empty() ? "none" : result;
+}
@@ -0,0 +1,67 @@
+#ifndef MODEL_POOL_H
+#define MODEL_POOL_H
+
+// Process-wide pool of Tesseract models. Filters with the same language can share one model
+// instead of each loading their own copy. Free of OBS types.
+
+#include <tesseract/baseapi.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+  * @brief A loaded Tesseract model, possibly used by several filters.
+  *
+  * A model is not thread safe: users hold the mutex while using it and re-apply their own
+  * settings (page segmentation mode, whitelist) after taking it.
+*/
+struct ocr_model {
+	ocr_model(tesseract::TessBaseAPI *api, const std::string &language, const std::string &key,
+		  uint64_t estimated_bytes);
+	~ocr_model();
+	ocr_model(const ocr_model &) = delete;
+	ocr_model &operator=(const ocr_model &) = delete;
+
+	tesseract::TessBaseAPI *const api;
+	const std::string language;
+	// tessdata path and language, empty if the model has its own configs and cannot be shared
+	const std::string key;
+	// estimated from the size of the traineddata files, Tesseract does not report its usage
+	const uint64_t estimated_bytes;
+	std::mutex mutex;
+};
+
+/**
+  * @brief Get a model for the language, loading it if needed.
+  *
+  * Without configs, a preloaded model for the same tessdata path and language is taken over
+  * (waiting for it if it is still loading), and with share set a model already in use by
+  * another filter is returned instead of loading another one. Throws if the model fails to
+  * load.
+*/
+std::shared_ptr<ocr_model> acquire_ocr_model(const char *tessdata_path,
+					     const std::string &language, char **configs,
+					     int configs_size, bool share);
+
+/**
+  * @brief Load a model ahead of the filter that is expected to ask for it.
+  *
+  * The next acquire_ocr_model for the language takes the model over, whether or not it
+  * shares models. Does nothing if the language is already preloaded or being preloaded.
+  *
+  * @return false if the model failed to load
+*/
+bool preload_ocr_model(const char *tessdata_path, const std::string &language);
+// Drop the preloaded models no filter took over, returns how many there were
+size_t release_preloaded_ocr_models();
+
+uint64_t estimate_ocr_model_bytes(const char *tessdata_path, const std::string &language);
+
+// Total estimated bytes of the loaded models
+uint64_t ocr_model_pool_bytes();
+// e.g. "eng (2 users, ~12.0MB), fra (preloaded, ~9.5MB)"
+std::string ocr_model_pool_summary();
+
+#endif /* MODEL_POOL_H */
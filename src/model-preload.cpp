@@ -0,0 +1,92 @@
+#include "model-preload.h"
+#include "model-pool.h"
+#include "plugin-config.h"
+#include "plugin-support.h"
+#include "ocr-stats.h"
+
+#include <obs-module.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// how long the preloaded models wait for the filters of the scene collection to take them
+// over, from the end of preloading, before they are released
+const std::chrono::seconds UNCLAIMED_PRELOAD_TIMEOUT(60);
+
+std::thread preload_thread;
+std::atomic<bool> stop_preload(false);
+std::mutex stop_mutex;
+std::condition_variable stop_cv;
+
+void preload_models(std::string tessdata_path, std::vector<std::string> languages)
+{
+	for (const auto &language : languages) {
+		if (stop_preload) {
+			return;
+		}
+		if (ocr_memory_over_budget()) {
+			obs_log(LOG_INFO, "Memory budget reached, not preloading more models");
+			return;
+		}
+		const auto start = std::chrono::steady_clock::now();
+		const bool loaded = preload_ocr_model(tessdata_path.c_str(), language);
+		const long long elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+						     std::chrono::steady_clock::now() - start)
+						     .count();
+		if (loaded) {
+			obs_log(LOG_INFO, "Preloaded model %s in %lld ms", language.c_str(),
+				elapsed_ms);
+		} else {
+			obs_log(LOG_WARNING, "Failed to preload model %s", language.c_str());
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(stop_mutex);
+	const bool stopped = stop_cv.wait_for(lock, UNCLAIMED_PRELOAD_TIMEOUT,
+					      [] { return stop_preload.load(); });
+	if (!stopped) {
+		lock.unlock();
+		// the filters loaded by now took theirs over, do not hold memory for the others
+		if (release_preloaded_ocr_models() > 0) {
+			obs_log(LOG_INFO, "Released the preloaded models no filter took over");
+		}
+	}
+}
+
+} // namespace
+
+void model_preload_start(void)
+{
+	std::vector<std::string> languages = get_plugin_config_preload_languages();
+	if (languages.empty() || preload_thread.joinable()) {
+		return;
+	}
+	char *tessdata_path = obs_module_file("tessdata");
+	if (tessdata_path == nullptr) {
+		obs_log(LOG_ERROR, "Cannot find the tessdata folder, not preloading models");
+		return;
+	}
+	stop_preload = false;
+	preload_thread = std::thread(preload_models, std::string(tessdata_path), languages);
+	bfree(tessdata_path);
+}
+
+void model_preload_stop(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(stop_mutex);
+		stop_preload = true;
+	}
+	stop_cv.notify_all();
+	if (preload_thread.joinable()) {
+		preload_thread.join();
+	}
+	release_preloaded_ocr_models();
+}
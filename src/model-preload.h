@@ -0,0 +1,20 @@
+#ifndef MODEL_PRELOAD_H
+#define MODEL_PRELOAD_H
+
+// Loading of the expected Tesseract models in the background when the plugin loads, so the
+// filters created with the scene collection do not stall the UI loading them. The models no
+// filter takes over within a minute of preloading are released.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void model_preload_start(void);
+// Stop preloading and drop the preloaded models no filter took over
+void model_preload_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODEL_PRELOAD_H */
@@ -1,5 +1,10 @@
 #include "obs-utils.h"
 #include "plugin-support.h"
+#include "ocr-trace.h"
+#include "ocr-pipeline.h"
+#include "consts.h"
+#include "capture-broker.h"
+#include "simd-kernels.h"
 
 #include <obs-module.h>
 
@@ -8,6 +13,8 @@
 
 #include <opencv2/core.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <filesystem>
 #include <mutex>
@@ -15,16 +22,104 @@
 #include <fstream>
 #include <regex>
 
+// With inputBGRALock held: inputBGRA, released first if it may be referenced elsewhere so the
+// next frame goes to a new buffer
+static cv::Mat &writable_input_frame(filter_data *tf)
+{
+	if (tf->inputBGRAShared) {
+		tf->inputBGRA.release();
+		tf->inputBGRAShared = false;
+	}
+	return tf->inputBGRA;
+}
+
+// With inputBGRALock held: publish the frame just written to inputBGRA
+static void input_frame_stored(filter_data *tf, uint64_t timestamp_ns, cv::Size source_size,
+			       const roi_atlas *atlas)
+{
+	tf->inputTimestampNs = timestamp_ns;
+	tf->inputSourceSize = source_size.empty() ? tf->inputBGRA.size() : source_size;
+	tf->inputAtlas = atlas != nullptr ? *atlas : roi_atlas();
+	tf->memory.set(OCR_MEMORY_INPUT_FRAME, mat_bytes(tf->inputBGRA));
+	tf->inputFrameSequence.fetch_add(1);
+}
+
+// After the lock is released: count the frame and wake the OCR thread
+static void wake_for_input_frame(filter_data *tf)
+{
+	tf->counters.staged.fetch_add(1, std::memory_order_relaxed);
+
+	// the OCR thread parks until a new frame arrives, wake it up
+	if (tf->waitingForFrame.load()) {
+		std::lock_guard<std::mutex> lock(tf->tesseract_mutex);
+		tf->tesseract_thread_cv.notify_all();
+	}
+}
+
 /**
-  * @brief Get RGBA from the stage surface
+  * @brief Hand a frame to the OCR thread
   *
   * @param tf  The filter data
-  * @param width  The width of the stage surface (output)
-  * @param height  The height of the stage surface (output)
+  * @param frame  The frame, BGRA or grayscale. Copied unless owned is set
+  * @param timestamp_ns  Capture time on the os_gettime_ns clock
+  * @param owned  The frame can be kept by reference instead of copied. It is never written to
+  * afterwards, so it may be shared with other filters
+  * @param source_size  Size of the source the frame was downscaled from, empty if not
+  * @param atlas  Where the regions are in the frame if it is a regions atlas, null if the
+  * frame shows the whole source
+*/
+void storeInputFrame(filter_data *tf, const cv::Mat &frame, uint64_t timestamp_ns, bool owned,
+		     cv::Size source_size, const roi_atlas *atlas)
+{
+	{
+		std::lock_guard<std::mutex> lock(tf->inputBGRALock);
+		if (owned) {
+			tf->inputBGRA = frame;
+			tf->inputBGRAShared = true;
+		} else {
+			frame.copyTo(writable_input_frame(tf));
+		}
+		input_frame_stored(tf, timestamp_ns, source_size, atlas);
+	}
+	wake_for_input_frame(tf);
+}
+
+/**
+  * @brief Hand a BGRA frame to the OCR thread as grayscale
+  *
+  * Reads the frame once with bgra_to_gray, straight into the input buffer, instead of copying
+  * it and converting it on the OCR thread.
+  *
+  * @param tf  The filter data
+  * @param bgra  The frame, e.g. a mapped staging surface
+  * @param timestamp_ns  Capture time on the os_gettime_ns clock
+  * @param source_size  Size of the source, which OCR results are scaled back to
+*/
+void storeInputFrameGray(filter_data *tf, const cv::Mat &bgra, uint64_t timestamp_ns,
+			 cv::Size source_size)
+{
+	{
+		OCR_TRACE_SPAN("fused_gray");
+		std::lock_guard<std::mutex> lock(tf->inputBGRALock);
+		bgra_to_gray(bgra, writable_input_frame(tf));
+		input_frame_stored(tf, timestamp_ns, source_size, nullptr);
+	}
+	wake_for_input_frame(tf);
+}
+
+/**
+  * @brief Render the filter target into the texrender
+  *
+  * The texture is both staged for OCR and drawn as the filter output, so the target is
+  * rendered only once per frame.
+  *
+  * @param tf  The filter data
+  * @param width  The width of the target (output)
+  * @param height  The height of the target (output)
   * @return true  if successful
   * @return false if unsuccessful
 */
-bool getRGBAFromStageSurface(filter_data *tf, uint32_t &width, uint32_t &height)
+bool renderFilterTarget(filter_data *tf, uint32_t &width, uint32_t &height)
 {
 
 	if (!obs_source_enabled(tf->source)) {
@@ -40,8 +135,11 @@ bool getRGBAFromStageSurface(filter_data *tf, uint32_t &width, uint32_t &height)
 	if (width == 0 || height == 0) {
 		return false;
 	}
+
+	OCR_TRACE_SPAN("capture");
 	gs_texrender_reset(tf->texrender);
-	if (!gs_texrender_begin(tf->texrender, width, height)) {
+	// HDR targets are tone mapped to sRGB, the space OCR reads and the output is drawn from
+	if (!gs_texrender_begin_with_color_space(tf->texrender, width, height, GS_CS_SRGB)) {
 		return false;
 	}
 	struct vec4 background;
@@ -54,6 +152,159 @@ bool getRGBAFromStageSurface(filter_data *tf, uint32_t &width, uint32_t &height)
 	obs_source_video_render(target);
 	gs_blend_state_pop();
 	gs_texrender_end(tf->texrender);
+	return true;
+}
+
+/**
+  * @brief Downscale the rendered target on the GPU to the size OCR rescales it to
+  *
+  * Drawing the rendered texture into a smaller texrender costs much less than rendering the
+  * target again, and the frame read back is then already at OCR size.
+  *
+  * @param tf  The filter data
+  * @param width  The width of the rendered target, replaced by the downscaled width
+  * @param height  The height of the rendered target, replaced by the downscaled height
+  * @return the downscaled texture, or the rendered one if there is nothing to downscale
+*/
+gs_texture_t *downscaleRenderedTarget(filter_data *tf, uint32_t &width, uint32_t &height)
+{
+	gs_texture_t *texture = gs_texrender_get_texture(tf->texrender);
+	if (tf->gpuRescale == GPU_RESCALE_OFF || !tf->rescaleImage || tf->rescaleTargetSize <= 0 ||
+	    (uint32_t)tf->rescaleTargetSize >= height) {
+		return texture;
+	}
+	// same scale as the CPU rescale in preprocess_image
+	const uint32_t scaled_height = (uint32_t)tf->rescaleTargetSize;
+	const uint32_t scaled_width =
+		std::max(1u, (uint32_t)std::lround((double)width * scaled_height / height));
+
+	OCR_TRACE_SPAN("gpu_rescale");
+	if (!tf->rescaleTexrender) {
+		tf->rescaleTexrender = gs_texrender_create(GS_BGRA, GS_ZS_NONE);
+	}
+	gs_texrender_reset(tf->rescaleTexrender);
+	if (!gs_texrender_begin(tf->rescaleTexrender, scaled_width, scaled_height)) {
+		return texture;
+	}
+	// the sprite is drawn at full size, the projection maps it onto the smaller target
+	gs_ortho(0.0f, static_cast<float>(width), 0.0f, static_cast<float>(height), -100.0f,
+		 100.0f);
+	gs_effect_t *effect = obs_get_base_effect(
+		tf->gpuRescale == GPU_RESCALE_AREA ? OBS_EFFECT_AREA : OBS_EFFECT_DEFAULT);
+	gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), texture);
+	gs_eparam_t *dimension = gs_effect_get_param_by_name(effect, "base_dimension");
+	gs_eparam_t *dimension_i = gs_effect_get_param_by_name(effect, "base_dimension_i");
+	if (dimension) {
+		struct vec2 base;
+		vec2_set(&base, (float)width, (float)height);
+		gs_effect_set_vec2(dimension, &base);
+	}
+	if (dimension_i) {
+		struct vec2 base_i;
+		vec2_set(&base_i, 1.0f / (float)width, 1.0f / (float)height);
+		gs_effect_set_vec2(dimension_i, &base_i);
+	}
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+	while (gs_effect_loop(effect, "Draw")) {
+		gs_draw_sprite(texture, 0, width, height);
+	}
+	gs_blend_state_pop();
+	gs_texrender_end(tf->rescaleTexrender);
+
+	width = scaled_width;
+	height = scaled_height;
+	return gs_texrender_get_texture(tf->rescaleTexrender);
+}
+
+/**
+  * @brief Draw the filter's regions of interest from the rendered target into one atlas
+  *
+  * The atlas layout is packed again only when the regions or the target size change. All
+  * regions are then staged with a single copy.
+  *
+  * @param tf  The filter data
+  * @param width  The width of the rendered target, replaced by the atlas width
+  * @param height  The height of the rendered target, replaced by the atlas height
+  * @return the atlas texture, or null if the filter has no regions or drawing failed
+*/
+gs_texture_t *drawRegionsAtlas(filter_data *tf, uint32_t &width, uint32_t &height)
+{
+	gs_texture_t *texture = gs_texrender_get_texture(tf->texrender);
+	const cv::Size source_size((int)width, (int)height);
+	{
+		std::lock_guard<std::mutex> lock(tf->regionsLock);
+		if (tf->regions.empty()) {
+			tf->atlas = roi_atlas();
+			return nullptr;
+		}
+		if (tf->regionsChanged || source_size != tf->atlasSourceSize) {
+			tf->atlas = pack_roi_atlas(tf->regions, source_size);
+			tf->atlasSourceSize = source_size;
+			tf->regionsChanged = false;
+		}
+	}
+	if (tf->atlas.empty() || !texture) {
+		return nullptr;
+	}
+
+	OCR_TRACE_SPAN("regions_atlas");
+	if (!tf->atlasTexrender) {
+		tf->atlasTexrender = gs_texrender_create(GS_BGRA, GS_ZS_NONE);
+	}
+	gs_texrender_reset(tf->atlasTexrender);
+	if (!gs_texrender_begin(tf->atlasTexrender, tf->atlas.size.width,
+				tf->atlas.size.height)) {
+		return nullptr;
+	}
+	struct vec4 background;
+	vec4_zero(&background);
+	gs_clear(GS_CLEAR_COLOR, &background, 0.0f, 0);
+	gs_ortho(0.0f, (float)tf->atlas.size.width, 0.0f, (float)tf->atlas.size.height, -100.0f,
+		 100.0f);
+	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"), texture);
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+	while (gs_effect_loop(effect, "Draw")) {
+		for (size_t i = 0; i < tf->atlas.tiles.size(); i++) {
+			const cv::Rect &region = tf->atlas.regions[i];
+			const cv::Rect &tile = tf->atlas.tiles[i];
+			gs_matrix_push();
+			gs_matrix_translate3f((float)tile.x, (float)tile.y, 0.0f);
+			gs_draw_sprite_subregion(texture, 0, region.x, region.y, region.width,
+						 region.height);
+			gs_matrix_pop();
+		}
+	}
+	gs_blend_state_pop();
+	gs_texrender_end(tf->atlasTexrender);
+
+	width = (uint32_t)tf->atlas.size.width;
+	height = (uint32_t)tf->atlas.size.height;
+	return gs_texrender_get_texture(tf->atlasTexrender);
+}
+
+/**
+  * @brief Get RGBA from the stage surface
+  *
+  * Stages the texture rendered by renderFilterTarget, or its downscaled copy, and copies it
+  * to the OCR input frame. A frame that was not downscaled or packed on the GPU is converted
+  * to grayscale while it is copied when it is binarized anyway, see storeInputFrameGray.
+  *
+  * @param tf  The filter data
+  * @param texture  The texture to stage
+  * @param width  The width of the texture
+  * @param height  The height of the texture
+  * @param source_size  The size of the target, which OCR results are scaled back to
+  * @param atlas  Where the regions are in the texture, if it is a regions atlas
+  * @return true  if successful
+  * @return false if unsuccessful
+*/
+bool getRGBAFromStageSurface(filter_data *tf, gs_texture_t *texture, uint32_t width,
+			     uint32_t height, cv::Size source_size, const roi_atlas *atlas)
+{
+	OCR_TRACE_SPAN("stage_map");
 
 	if (tf->stagesurface) {
 		uint32_t stagesurf_width = gs_stagesurface_get_width(tf->stagesurface);
@@ -66,20 +317,116 @@ bool getRGBAFromStageSurface(filter_data *tf, uint32_t &width, uint32_t &height)
 	if (!tf->stagesurface) {
 		tf->stagesurface = gs_stagesurface_create(width, height, GS_BGRA);
 	}
-	gs_stage_texture(tf->stagesurface, gs_texrender_get_texture(tf->texrender));
+	gs_stage_texture(tf->stagesurface, texture);
 	uint8_t *video_data;
 	uint32_t linesize;
 	if (!gs_stagesurface_map(tf->stagesurface, &video_data, &linesize)) {
 		return false;
 	}
-	{
-		std::lock_guard<std::mutex> lock(tf->inputBGRALock);
-		tf->inputBGRA = cv::Mat(height, width, CV_8UC4, video_data, linesize);
+	// copy out of the staging surface, its memory is only valid while mapped
+	cv::Mat mapped(height, width, CV_8UC4, video_data, linesize);
+	const bool full_size = (int)width == source_size.width && (int)height == source_size.height;
+	ocr_pipeline_settings gray_settings;
+	gray_settings.binarizationMode = tf->binarizationMode;
+	if (!tf->captureShared && atlas == nullptr && full_size &&
+	    preprocess_accepts_gray(gray_settings)) {
+		// convert while copying, binarization would convert it the same way. Not
+		// downscaled: preprocess_image binarizes and dilates at full size, then rescales.
+		storeInputFrameGray(tf, mapped, obs_get_video_frame_time(), source_size);
+	} else if (tf->captureShared) {
+		// a new buffer per frame, the other filters on the source keep references to it
+		cv::Mat frame = mapped.clone();
+		storeInputFrame(tf, frame, obs_get_video_frame_time(), true, source_size, atlas);
+		capture_broker_publish(tf, frame, obs_get_video_frame_time(), source_size);
+	} else {
+		storeInputFrame(tf, mapped, obs_get_video_frame_time(), false, source_size, atlas);
 	}
 	gs_stagesurface_unmap(tf->stagesurface);
 	return true;
 }
 
+/**
+  * @brief Get the luma of an async source frame, without going through the GPU
+  *
+  * Planar and semi-planar YUV frames give their Y plane as is, packed YUV and RGB frames are
+  * converted on the CPU. Flipped frames are turned upright.
+  *
+  * @param tf  The filter data
+  * @param frame  The frame of the async source
+  * @return true  if successful
+  * @return false if the frame format is not supported
+*/
+bool getGrayFromAsyncFrame(filter_data *tf, const struct obs_source_frame *frame)
+{
+	OCR_TRACE_SPAN("async_frame_tap");
+
+	const int width = (int)frame->width;
+	const int height = (int)frame->height;
+	cv::Mat gray;
+	bool limited_range = !frame->full_range;
+	switch (frame->format) {
+	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_I422:
+	case VIDEO_FORMAT_I444:
+	case VIDEO_FORMAT_I40A:
+	case VIDEO_FORMAT_I42A:
+	case VIDEO_FORMAT_YUVA:
+	case VIDEO_FORMAT_Y800:
+		gray = cv::Mat(height, width, CV_8UC1, frame->data[0], frame->linesize[0]);
+		limited_range = limited_range && frame->format != VIDEO_FORMAT_Y800;
+		break;
+	case VIDEO_FORMAT_P010:
+	case VIDEO_FORMAT_I010:
+		// 10 bits in 16, P010 keeps them in the high bits and I010 in the low bits
+		cv::Mat(height, width, CV_16UC1, frame->data[0], frame->linesize[0])
+			.convertTo(gray, CV_8U,
+				   frame->format == VIDEO_FORMAT_P010 ? 1.0 / 256.0 : 1.0 / 4.0);
+		break;
+	case VIDEO_FORMAT_YUY2:
+	case VIDEO_FORMAT_YVYU:
+	case VIDEO_FORMAT_UYVY:
+		cv::extractChannel(cv::Mat(height, width, CV_8UC2, frame->data[0],
+					   frame->linesize[0]),
+				   gray, frame->format == VIDEO_FORMAT_UYVY ? 1 : 0);
+		break;
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_BGRX:
+		cv::cvtColor(cv::Mat(height, width, CV_8UC4, frame->data[0], frame->linesize[0]),
+			     gray, cv::COLOR_BGRA2GRAY);
+		limited_range = false;
+		break;
+	case VIDEO_FORMAT_RGBA:
+		cv::cvtColor(cv::Mat(height, width, CV_8UC4, frame->data[0], frame->linesize[0]),
+			     gray, cv::COLOR_RGBA2GRAY);
+		limited_range = false;
+		break;
+	case VIDEO_FORMAT_BGR3:
+		cv::cvtColor(cv::Mat(height, width, CV_8UC3, frame->data[0], frame->linesize[0]),
+			     gray, cv::COLOR_BGR2GRAY);
+		limited_range = false;
+		break;
+	default:
+		return false;
+	}
+	if (limited_range) {
+		// stretch 16-235 to the full range the binarization thresholds expect, into a new
+		// Mat since gray may point into the frame
+		cv::Mat full_range;
+		gray.convertTo(full_range, CV_8U, 255.0 / 219.0, -16.0 * 255.0 / 219.0);
+		gray = full_range;
+	}
+	if (frame->flip) {
+		// the rows are stored bottom up, OBS flips the frame when it draws it
+		cv::Mat upright;
+		cv::flip(gray, upright, 0);
+		gray = upright;
+	}
+	// a gray Mat pointing into the frame is copied, a converted one is moved in
+	storeInputFrame(tf, gray, os_gettime_ns(), gray.u != nullptr);
+	return true;
+}
+
 /*            OUTPUT TEXT SOURCE UTIL             */
 
 void acquire_weak_output_source_ref(struct filter_data *usd, char *output_source_name_for_ref,
@@ -112,7 +459,7 @@ void acquire_weak_output_source_ref(struct filter_data *usd, char *output_source
 	}
 }
 
-void setTextCallback(const std::string &str_in, struct filter_data *usd)
+void setTextCallback(const std::string &str_in, struct filter_data *usd, int64_t latency_ms)
 {
 	if (!usd->output_source_mutex) {
 		obs_log(LOG_ERROR, "output_source_mutex is null");
@@ -133,6 +480,9 @@ void setTextCallback(const std::string &str_in, struct filter_data *usd)
 	// update internal settings
 	auto internal_source_settings = obs_source_get_settings(usd->source);
 	obs_data_set_string(internal_source_settings, "current_output", str.c_str());
+	if (latency_ms >= 0) {
+		obs_data_set_int(internal_source_settings, "current_output_latency_ms", latency_ms);
+	}
 	obs_data_release(internal_source_settings);
 
 	// check if save_to_file is selected
@@ -3,7 +3,17 @@
 
 #include "filter-data.h"
 
-bool getRGBAFromStageSurface(filter_data *tf, uint32_t &width, uint32_t &height);
+bool renderFilterTarget(filter_data *tf, uint32_t &width, uint32_t &height);
+gs_texture_t *downscaleRenderedTarget(filter_data *tf, uint32_t &width, uint32_t &height);
+gs_texture_t *drawRegionsAtlas(filter_data *tf, uint32_t &width, uint32_t &height);
+bool getRGBAFromStageSurface(filter_data *tf, gs_texture_t *texture, uint32_t width,
+			     uint32_t height, cv::Size source_size,
+			     const roi_atlas *atlas = nullptr);
+bool getGrayFromAsyncFrame(filter_data *tf, const struct obs_source_frame *frame);
+void storeInputFrame(filter_data *tf, const cv::Mat &frame, uint64_t timestamp_ns, bool owned,
+		     cv::Size source_size = cv::Size(), const roi_atlas *atlas = nullptr);
+void storeInputFrameGray(filter_data *tf, const cv::Mat &bgra, uint64_t timestamp_ns,
+			 cv::Size source_size);
 
 inline bool is_valid_output_source_name(const char *output_source_name)
 {
@@ -13,7 +23,8 @@ inline bool is_valid_output_source_name(const char *output_source_name)
 
 void acquire_weak_output_source_ref(struct filter_data *usd);
 
-void setTextCallback(const std::string &str, struct filter_data *usd);
+// latency_ms: capture-to-output latency of the text, stored with it in the filter settings
+void setTextCallback(const std::string &str, struct filter_data *usd, int64_t latency_ms = -1);
 void setTextDetectionMaskCallback(const cv::Mat &mask, struct filter_data *usd);
 
 bool add_text_sources_to_list(void *list_property, obs_source_t *source);
@@ -12,6 +12,7 @@
 #include <QString>
 
 #include <util/bmem.h>
+#include <util/platform.h>
 
 #include <plugin-support.h>
 #include "filter-data.h"
@@ -19,6 +20,10 @@
 #include "consts.h"
 #include "tesseract-ocr-utils.h"
 #include "ocr-filter.h"
+#include "ocr-trace.h"
+#include "frame-recorder.h"
+#include "program-capture.h"
+#include "capture-broker.h"
 
 const char *ocr_filter_getname(void *unused)
 {
@@ -68,6 +73,8 @@ bool rescale_modified(obs_properties_t *props_modified, obs_property_t *property
 	bool rescale_image = obs_data_get_bool(settings, "rescale_image");
 	obs_property_set_visible(obs_properties_get(props_modified, "rescale_target_size"),
 				 rescale_image);
+	obs_property_set_visible(obs_properties_get(props_modified, "gpu_rescale"),
+				 rescale_image);
 	UNUSED_PARAMETER(property);
 	return true;
 }
@@ -96,6 +103,54 @@ obs_properties_t *ocr_filter_properties(void *data)
 	// Add update timer property
 	obs_properties_add_int(props, "update_timer", obs_module_text("UpdateTimer"), 1, 100000, 1);
 
+	// Read the program output instead of this source, e.g. to OCR the final feed without
+	// rendering a nested scene for it
+	obs_properties_add_bool(props, "program_output", obs_module_text("ProgramOutput"));
+	obs_properties_add_int_slider(props, "program_output_scale",
+				      obs_module_text("ProgramOutputScale"), 10, 100, 5);
+	obs_property_set_modified_callback(
+		obs_properties_get(props, "program_output"),
+		[](obs_properties_t *props_modified, obs_property_t *, obs_data_t *settings) {
+			obs_property_set_visible(
+				obs_properties_get(props_modified, "program_output_scale"),
+				obs_data_get_bool(settings, "program_output"));
+			return true;
+		});
+
+	// Hide text matching a pattern or keywords in the output, e.g. emails or a real name
+	obs_property_t *redaction_list =
+		obs_properties_add_list(props, "redaction_mode", obs_module_text("RedactionMode"),
+					OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(redaction_list, obs_module_text("RedactionModeOff"),
+				  (long long)REDACTION_MODE_OFF);
+	obs_property_list_add_int(redaction_list, obs_module_text("RedactionModePixelate"),
+				  (long long)REDACTION_MODE_PIXELATE);
+	obs_property_list_add_int(redaction_list, obs_module_text("RedactionModeBlur"),
+				  (long long)REDACTION_MODE_BLUR);
+	obs_properties_add_text(props, "redaction_pattern", obs_module_text("RedactionPattern"),
+				OBS_TEXT_DEFAULT);
+	obs_properties_add_text(props, "redaction_keywords", obs_module_text("RedactionKeywords"),
+				OBS_TEXT_DEFAULT);
+	obs_properties_add_int(props, "redaction_padding", obs_module_text("RedactionPadding"), 0,
+			       100, 1);
+	obs_properties_add_int(props, "redaction_hold_ms", obs_module_text("RedactionHold"), 0,
+			       60000, 100);
+	obs_properties_add_int_slider(props, "redaction_strength",
+				      obs_module_text("RedactionStrength"), 4, 64, 1);
+	obs_property_set_modified_callback(
+		redaction_list,
+		[](obs_properties_t *props_modified, obs_property_t *, obs_data_t *settings) {
+			const bool redaction = obs_data_get_int(settings, "redaction_mode") !=
+					       REDACTION_MODE_OFF;
+			for (const char *prop :
+			     {"redaction_pattern", "redaction_keywords", "redaction_padding",
+			      "redaction_hold_ms", "redaction_strength"}) {
+				obs_property_set_visible(obs_properties_get(props_modified, prop),
+							 redaction);
+			}
+			return true;
+		});
+
 	// add advanced settings checkbox
 	obs_properties_add_bool(props, "advanced_settings", obs_module_text("AdvancedSettings"));
 
@@ -118,9 +173,11 @@ obs_properties_t *ocr_filter_properties(void *data)
 			      "user_patterns", "enable_smoothing", "word_length", "window_size",
 			      "update_on_change", "binarization_mode", "preview_binarization",
 			      "binarization_threshold", "binarization_block_size", "rescale_image",
-			      "rescale_target_size", "update_on_change_threshold",
+			      "rescale_target_size", "gpu_rescale", "update_on_change_threshold",
 			      "dilation_iterations", "output_flatten", "char_whitelist_preset",
-			      "current_output"}) {
+			      "current_output", "ocr_stats", "enable_tracing", "trace_rolling",
+			      "save_trace", "record_frames", "record_max_frames",
+			      "idle_unload_seconds", "regions", "scroll_mode", "track_boxes"}) {
 				obs_property_set_visible(obs_properties_get(props_modified, prop),
 							 advanced_settings);
 			}
@@ -134,6 +191,24 @@ obs_properties_t *ocr_filter_properties(void *data)
 			return true;
 		});
 
+	// Read only these parts of the source, e.g. "10,10,400,60; 10,500,400,60"
+	obs_properties_add_text(props, "regions", obs_module_text("Regions"), OBS_TEXT_DEFAULT);
+
+	// Tickers and chat boxes: read only the text that scrolled into view
+	obs_property_t *scroll_list =
+		obs_properties_add_list(props, "scroll_mode", obs_module_text("ScrollMode"),
+					OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(scroll_list, obs_module_text("ScrollModeOff"),
+				  (long long)SCROLL_MODE_OFF);
+	obs_property_list_add_int(scroll_list, obs_module_text("ScrollModeVertical"),
+				  (long long)SCROLL_MODE_VERTICAL);
+	obs_property_list_add_int(scroll_list, obs_module_text("ScrollModeHorizontal"),
+				  (long long)SCROLL_MODE_HORIZONTAL);
+
+	// Move the image output and redacted boxes with the text on every frame, OCR only when
+	// they are lost
+	obs_properties_add_bool(props, "track_boxes", obs_module_text("TrackBoxes"));
+
 	// Add page segmentation mode property
 	obs_property_t *psm_list = obs_properties_add_list(props, "page_segmentation_mode",
 							   obs_module_text("PageSegmentationMode"),
@@ -192,18 +267,21 @@ obs_properties_t *ocr_filter_properties(void *data)
 	obs_properties_add_int_slider(props, "rescale_target_size",
 				      obs_module_text("RescaleTargetSize"), 10, 100, 1);
 
+	// add the GPU rescale option: downscale while capturing, so the frame read back is already
+	// at the rescaled size
+	obs_property_t *gpu_rescale_list = obs_properties_add_list(
+		props, "gpu_rescale", obs_module_text("GPURescale"), OBS_COMBO_TYPE_LIST,
+		OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(gpu_rescale_list, obs_module_text("GPURescaleOff"),
+				  GPU_RESCALE_OFF);
+	obs_property_list_add_int(gpu_rescale_list, obs_module_text("GPURescaleBilinear"),
+				  GPU_RESCALE_BILINEAR);
+	obs_property_list_add_int(gpu_rescale_list, obs_module_text("GPURescaleArea"),
+				  GPU_RESCALE_AREA);
+
 	// add callback to enable or disable the rescale target size property
-	obs_property_set_modified_callback(
-		obs_properties_get(props, "rescale_image"),
-		[](obs_properties_t *props_modified, obs_property_t *property,
-		   obs_data_t *settings) {
-			bool rescale_image = obs_data_get_bool(settings, "rescale_image");
-			obs_property_set_visible(obs_properties_get(props_modified,
-								    "rescale_target_size"),
-						 rescale_image);
-			UNUSED_PARAMETER(property);
-			return true;
-		});
+	obs_property_set_modified_callback(obs_properties_get(props, "rescale_image"),
+					   rescale_modified);
 
 	// add preset selector for char whitelist
 	obs_property_t *char_whitelist_preset = obs_properties_add_list(
@@ -264,10 +342,13 @@ obs_properties_t *ocr_filter_properties(void *data)
 	obs_property_set_modified_callback(enable_smoothing_property, enable_smoothing_modified);
 
 	// Output formatting
-	obs_properties_add_text(props, "output_formatting", obs_module_text("OutputFormatting"),
-				OBS_TEXT_MULTILINE);
+	obs_property_t *output_formatting =
+		obs_properties_add_text(props, "output_formatting",
+					obs_module_text("OutputFormatting"), OBS_TEXT_MULTILINE);
+	obs_property_set_long_description(output_formatting,
+					  obs_module_text("OutputFormattingDescription"));
 	// hide the output formatting property by default
-	obs_property_set_visible(obs_properties_get(props, "output_formatting"), false);
+	obs_property_set_visible(output_formatting, false);
 
 	// add option to "flatten" the output text to a single line
 	obs_properties_add_bool(props, "output_flatten", obs_module_text("OutputFlatten"));
@@ -365,6 +446,44 @@ obs_properties_t *ocr_filter_properties(void *data)
 				OBS_TEXT_DEFAULT);
 	obs_property_set_enabled(obs_properties_get(props, "current_output"), false);
 
+	// add frame accounting and latency statistics, refreshed by the OCR thread
+	obs_properties_add_text(props, "ocr_stats", obs_module_text("OCRStats"),
+				OBS_TEXT_MULTILINE);
+	obs_property_set_enabled(obs_properties_get(props, "ocr_stats"), false);
+
+	// Add tracing options: record pipeline spans and save them as Chrome trace-event JSON
+	obs_properties_add_bool(props, "enable_tracing", obs_module_text("EnableTracing"));
+	obs_properties_add_bool(props, "trace_rolling", obs_module_text("TraceRolling"));
+	obs_properties_add_button(
+		props, "save_trace", obs_module_text("SaveTrace"),
+		[](obs_properties_t *, obs_property_t *, void *) {
+			if (!ocr_trace_enabled()) {
+				obs_log(LOG_WARNING, "Tracing is not enabled, nothing to save");
+				return false;
+			}
+			check_plugin_config_folder_exists();
+			std::string filename = "trace-" + std::to_string(os_gettime_ns()) + ".json";
+			char *trace_path = obs_module_config_path(filename.c_str());
+			if (ocr_trace_dump(trace_path)) {
+				obs_log(LOG_INFO, "Saved trace to %s", trace_path);
+			} else {
+				obs_log(LOG_ERROR, "Failed to save trace to %s", trace_path);
+			}
+			bfree(trace_path);
+			return false;
+		});
+
+	// Add the idle unload period: the model and buffers of a filter that stays inactive are
+	// released and loaded back when it becomes active again
+	obs_properties_add_int(props, "idle_unload_seconds", obs_module_text("IdleUnloadSeconds"),
+			       0, 3600, 10);
+
+	// Add frame recording options: the frames given to OCR are written to a bounded ring file
+	// in the plugin config folder, for replay with the benchmark tool
+	obs_properties_add_bool(props, "record_frames", obs_module_text("RecordFrames"));
+	obs_properties_add_int(props, "record_max_frames", obs_module_text("RecordMaxFrames"), 1,
+			       100000, 1);
+
 	// Add a informative text about the plugin
 	obs_properties_add_text(
 		props, "info",
@@ -402,6 +521,23 @@ void ocr_filter_defaults(obs_data_t *settings)
 	obs_data_set_default_int(settings, "image_output_option", 0);
 	obs_data_set_default_bool(settings, "output_file_append", false);
 	obs_data_set_default_bool(settings, "output_flatten", false);
+	obs_data_set_default_bool(settings, "enable_tracing", false);
+	obs_data_set_default_bool(settings, "trace_rolling", false);
+	obs_data_set_default_bool(settings, "record_frames", false);
+	obs_data_set_default_int(settings, "record_max_frames", 300);
+	obs_data_set_default_int(settings, "idle_unload_seconds", 60);
+	obs_data_set_default_bool(settings, "program_output", false);
+	obs_data_set_default_int(settings, "program_output_scale", 50);
+	obs_data_set_default_int(settings, "gpu_rescale", GPU_RESCALE_OFF);
+	obs_data_set_default_string(settings, "regions", "");
+	obs_data_set_default_int(settings, "scroll_mode", SCROLL_MODE_OFF);
+	obs_data_set_default_bool(settings, "track_boxes", false);
+	obs_data_set_default_int(settings, "redaction_mode", REDACTION_MODE_OFF);
+	obs_data_set_default_string(settings, "redaction_pattern", "");
+	obs_data_set_default_string(settings, "redaction_keywords", "");
+	obs_data_set_default_int(settings, "redaction_padding", 4);
+	obs_data_set_default_int(settings, "redaction_hold_ms", 1000);
+	obs_data_set_default_int(settings, "redaction_strength", 16);
 }
 
 void ocr_filter_update(void *data, obs_data_t *settings)
@@ -430,6 +566,7 @@ void ocr_filter_update(void *data, obs_data_t *settings)
 	tf->dilationIterations = (int)obs_data_get_int(settings, "dilation_iterations");
 	tf->rescaleImage = obs_data_get_bool(settings, "rescale_image");
 	tf->rescaleTargetSize = (int)obs_data_get_int(settings, "rescale_target_size");
+	tf->gpuRescale = (int)obs_data_get_int(settings, "gpu_rescale");
 	tf->char_whitelist = obs_data_get_string(settings, "char_whitelist");
 	tf->conf_threshold = (int)obs_data_get_int(settings, "conf_threshold");
 	tf->enable_smoothing = obs_data_get_bool(settings, "enable_smoothing");
@@ -443,21 +580,117 @@ void ocr_filter_update(void *data, obs_data_t *settings)
 	tf->output_image_option = (int)obs_data_get_int(settings, "image_output_option");
 	tf->output_file_append = obs_data_get_bool(settings, "output_file_append");
 	tf->output_flatten = obs_data_get_bool(settings, "output_flatten");
+	tf->idle_unload_seconds = (uint32_t)obs_data_get_int(settings, "idle_unload_seconds");
+
+	tf->scrollMode = (int)obs_data_get_int(settings, "scroll_mode");
+	tf->trackBoxes = obs_data_get_bool(settings, "track_boxes");
+
+	tf->redactionMode = (int)obs_data_get_int(settings, "redaction_mode");
+	tf->redactionPadding = (int)obs_data_get_int(settings, "redaction_padding");
+	tf->redactionHoldMs = (uint32_t)obs_data_get_int(settings, "redaction_hold_ms");
+	tf->redactionStrength = (int)obs_data_get_int(settings, "redaction_strength");
+	{
+		const std::string keywords = obs_data_get_string(settings, "redaction_keywords");
+		text_redactor redactor;
+		try {
+			redactor = text_redactor(obs_data_get_string(settings, "redaction_pattern"),
+						 keywords);
+		} catch (const std::regex_error &e) {
+			obs_log(LOG_ERROR, "Invalid redaction pattern, using the keywords only: %s",
+				e.what());
+			redactor = text_redactor("", keywords);
+		}
+		std::lock_guard<std::mutex> lock(tf->tesseract_settings_mutex);
+		tf->redactor = std::move(redactor);
+	}
+	if (tf->redactionMode == REDACTION_MODE_OFF) {
+		std::lock_guard<std::mutex> lock(tf->redactionLock);
+		tf->redactionBoxes.clear();
+	}
+
+	std::vector<cv::Rect> regions = parse_regions(obs_data_get_string(settings, "regions"));
+	tf->hasRegions = !regions.empty();
+	{
+		std::lock_guard<std::mutex> lock(tf->regionsLock);
+		if (regions != tf->regions) {
+			tf->regions = std::move(regions);
+			tf->regionsChanged = true;
+		}
+	}
+
+	const bool trace_enabled = obs_data_get_bool(settings, "enable_tracing");
+	if (trace_enabled != tf->trace_enabled) {
+		if (trace_enabled) {
+			ocr_trace_enable();
+		} else {
+			ocr_trace_disable();
+		}
+		tf->trace_enabled = trace_enabled;
+	}
+	tf->trace_rolling = obs_data_get_bool(settings, "trace_rolling");
+
+	const bool record_frames = obs_data_get_bool(settings, "record_frames");
+	const uint32_t record_max_frames =
+		(uint32_t)obs_data_get_int(settings, "record_max_frames");
+	if (record_frames != tf->record_frames || record_max_frames != tf->record_max_frames) {
+		std::lock_guard<std::mutex> lock(tf->tesseract_settings_mutex);
+		tf->recorder.reset();
+		if (record_frames) {
+			check_plugin_config_folder_exists();
+			std::string filename = "recording-" + tf->unique_id + ".ocrrec";
+			char *recording_path = obs_module_config_path(filename.c_str());
+			obs_log(LOG_INFO, "Recording up to %u frames to %s", record_max_frames,
+				recording_path);
+			tf->recorder =
+				std::make_unique<frame_recorder>(recording_path, record_max_frames);
+			bfree(recording_path);
+		}
+		tf->record_frames = record_frames;
+		tf->record_max_frames = record_max_frames;
+	}
 
 	// Initialize the Tesseract OCR model
 	initialize_tesseract_ocr(tf, hard_tesseract_init_required);
+
+	update_program_capture(tf, obs_data_get_bool(settings, "program_output"),
+			       (uint32_t)obs_data_get_int(settings, "program_output_scale"));
 }
 
 void ocr_filter_activate(void *data)
 {
 	struct filter_data *tf = reinterpret_cast<filter_data *>(data);
+	tf->activated_at_ns.store(get_time_ns(), std::memory_order_relaxed);
 	tf->isDisabled = false;
+	wake_tesseract_thread(tf);
 }
 
 void ocr_filter_deactivate(void *data)
 {
 	struct filter_data *tf = reinterpret_cast<filter_data *>(data);
+	if (tf->programCapture) {
+		// the program output is read whether or not the source is shown
+		return;
+	}
 	tf->isDisabled = true;
+	// let the OCR thread start counting the idle period
+	wake_tesseract_thread(tf);
+}
+
+// OCR follows the program output (activate/deactivate). A source shown elsewhere, e.g. in the
+// studio mode preview, is likely to go live: its filter keeps its model loaded, or loads it.
+void ocr_filter_show(void *data)
+{
+	struct filter_data *tf = reinterpret_cast<filter_data *>(data);
+	tf->isShown = true;
+	wake_tesseract_thread(tf);
+}
+
+void ocr_filter_hide(void *data)
+{
+	struct filter_data *tf = reinterpret_cast<filter_data *>(data);
+	tf->isShown = false;
+	// let the OCR thread start counting the idle period
+	wake_tesseract_thread(tf);
 }
 
 /**                   FILTER CORE                     */
@@ -478,7 +711,7 @@ void *ocr_filter_create(obs_data_t *settings, obs_source_t *source)
 	// get the models folder path from the module
 	tf->tesseractTraineddataFilepath = obs_module_file("tessdata");
 
-	tf->tesseract_model = nullptr;
+	tf->tesseract_model.reset();
 
 	obs_enter_graphics();
 	char *error;
@@ -499,8 +732,19 @@ void ocr_filter_destroy(void *data)
 	struct filter_data *tf = reinterpret_cast<filter_data *>(data);
 
 	if (tf) {
+		stop_program_capture(tf);
+		capture_broker_detach(tf);
+
 		obs_enter_graphics();
 		gs_texrender_destroy(tf->texrender);
+		if (tf->rescaleTexrender) {
+			gs_texrender_destroy(tf->rescaleTexrender);
+		}
+		if (tf->atlasTexrender) {
+			gs_texrender_destroy(tf->atlasTexrender);
+		}
+		gpu_change_detection_destroy(tf->changeDetection);
+		gpu_redaction_destroy(tf->redaction);
 		if (tf->stagesurface) {
 			gs_stagesurface_destroy(tf->stagesurface);
 		}
@@ -513,17 +757,21 @@ void ocr_filter_destroy(void *data)
 		obs_leave_graphics();
 
 		stop_and_join_tesseract_thread(tf);
+		// release the tracker's buffers while their arena is alive
+		tf->tracker.clear();
+
+		log_filter_stats(tf);
+
+		if (tf->trace_enabled) {
+			ocr_trace_disable();
+		}
 
 		cleanup_config_files(tf->unique_id);
 
 		if (tf->tesseractTraineddataFilepath != nullptr) {
 			bfree(tf->tesseractTraineddataFilepath);
 		}
-		if (tf->tesseract_model != nullptr) {
-			tf->tesseract_model->End();
-			delete tf->tesseract_model;
-			tf->tesseract_model = nullptr;
-		}
+		tf->tesseract_model.reset();
 		if (tf->output_source_mutex) {
 			delete tf->output_source_mutex;
 			tf->output_source_mutex = nullptr;
@@ -534,46 +782,229 @@ void ocr_filter_destroy(void *data)
 	}
 }
 
+/**
+  * @brief Whether an async frame given to filter_video is what the filter renders as its input.
+  *
+  * OBS filters async frames before any filter draws on the GPU, wherever this filter is in the
+  * chain. The frame is the input only if every enabled filter before this one works on the
+  * async frames too, or is an OCR filter that outputs its input unchanged.
+*/
+static bool async_frame_is_input(filter_data *tf, const struct obs_source_frame *frame)
+{
+	obs_source_t *parent = obs_filter_get_parent(tf->source);
+	if (parent == nullptr || frame->width != obs_source_get_base_width(parent) ||
+	    frame->height != obs_source_get_base_height(parent)) {
+		return false;
+	}
+	for (obs_source_t *target = obs_filter_get_target(tf->source);
+	     target != nullptr && target != parent; target = obs_filter_get_target(target)) {
+		if (!obs_source_enabled(target) ||
+		    (obs_source_get_output_flags(target) & OBS_SOURCE_ASYNC) != 0) {
+			continue;
+		}
+		if (strcmp(obs_source_get_id(target), "ocr_filter") != 0) {
+			return false;
+		}
+		const filter_data *upstream =
+			reinterpret_cast<const filter_data *>(obs_obj_get_data(target));
+		if (upstream == nullptr || !upstream->outputUnchanged) {
+			return false;
+		}
+	}
+	return true;
+}
+
+struct obs_source_frame *ocr_filter_video(void *data, struct obs_source_frame *frame)
+{
+	struct filter_data *tf = reinterpret_cast<filter_data *>(data);
+
+	if (tf->isDisabled || tf->programCapture || frame == nullptr) {
+		return frame;
+	}
+	// otherwise the frames are captured on the GPU after the filters before this one
+	const bool tapped = async_frame_is_input(tf, frame) && getGrayFromAsyncFrame(tf, frame);
+	if (tapped != tf->asyncFrameTap.exchange(tapped)) {
+		obs_log(LOG_INFO, "[%s] %s", obs_source_get_name(tf->source),
+			tapped ? "taking frames from the async source on the CPU"
+			       : "async frames are filtered or unsupported, capturing on the GPU");
+	}
+	return frame;
+}
+
+// Redact the held boxes over the output, sampling them from the rendered target
+static void draw_redaction(filter_data *tf, uint32_t width, uint32_t height,
+			   const std::vector<cv::Rect> &boxes)
+{
+	if (tf->targetRendered && !boxes.empty()) {
+		gpu_redaction_draw(tf, gs_texrender_get_texture(tf->texrender), width, height,
+				   boxes);
+		tf->outputUnchanged = false;
+	}
+}
+
+/**
+  * @brief Draw the target rendered by renderFilterTarget as the filter output, instead of
+  * rendering the target a second time with obs_source_skip_video_filter.
+  *
+  * The texrender holds the target in sRGB, so it is drawn like OBS's own filters draw an sRGB
+  * texrender: linearized when sampled and encoded again by the framebuffer. Other canvas color
+  * spaces (HDR) render the target again, which OBS converts.
+*/
+static void draw_rendered_target(filter_data *tf, uint32_t width, uint32_t height,
+				 const std::vector<cv::Rect> &redacted)
+{
+	gs_texture_t *tex = tf->targetRendered ? gs_texrender_get_texture(tf->texrender) : nullptr;
+	if (!tex || gs_get_color_space() != GS_CS_SRGB) {
+		obs_source_skip_video_filter(tf->source);
+		if (tex) {
+			draw_redaction(tf, width, height, redacted);
+		}
+		return;
+	}
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(true);
+	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	gs_effect_set_texture_srgb(gs_effect_get_param_by_name(effect, "image"), tex);
+	while (gs_effect_loop(effect, "Draw")) {
+		gs_draw_sprite(tex, 0, width, height);
+	}
+	gs_enable_framebuffer_srgb(previous);
+	draw_redaction(tf, width, height, redacted);
+}
+
+/**
+  * @brief Upload the latest preview to the preview texture if the OCR thread made a new one.
+  *
+  * The texture is dynamic and only created again when the preview size or format changes.
+  * Binarized previews are uploaded as one channel and expanded by the effect.
+  *
+  * @return the preview texture, or null if there is no preview yet
+*/
+static gs_texture_t *update_preview_texture(filter_data *tf)
+{
+	std::lock_guard<std::mutex> lock(tf->outputPreviewLock);
+	if (tf->outputPreview.empty()) {
+		return nullptr;
+	}
+	if (tf->outputPreviewTexture != nullptr &&
+	    tf->outputPreviewSequence == tf->outputPreviewUploaded) {
+		return tf->outputPreviewTexture;
+	}
+
+	const cv::Mat &preview = tf->outputPreview;
+	// BGRA previews are uploaded as RGBA and swizzled back by the effect
+	const gs_color_format format = preview.channels() == 1 ? GS_R8 : GS_RGBA;
+	if (tf->outputPreviewTexture == nullptr ||
+	    gs_texture_get_width(tf->outputPreviewTexture) != (uint32_t)preview.cols ||
+	    gs_texture_get_height(tf->outputPreviewTexture) != (uint32_t)preview.rows ||
+	    gs_texture_get_color_format(tf->outputPreviewTexture) != format) {
+		if (tf->outputPreviewTexture != nullptr) {
+			gs_texture_destroy(tf->outputPreviewTexture);
+		}
+		tf->outputPreviewTexture = gs_texture_create(preview.cols, preview.rows, format, 1,
+							     nullptr, GS_DYNAMIC);
+		if (tf->outputPreviewTexture == nullptr) {
+			return nullptr;
+		}
+	}
+	gs_texture_set_image(tf->outputPreviewTexture, preview.data, (uint32_t)preview.step,
+			     false);
+	tf->outputPreviewUploaded = tf->outputPreviewSequence;
+	return tf->outputPreviewTexture;
+}
+
 void ocr_filter_video_render(void *data, gs_effect_t *_effect)
 {
 	UNUSED_PARAMETER(_effect);
 
 	struct filter_data *tf = reinterpret_cast<filter_data *>(data);
 
-	if (tf->isDisabled) {
+	OCR_TRACE_SPAN("video_render");
+	// cleared below when redaction or the preview is drawn over the target
+	tf->outputUnchanged = true;
+
+	if (tf->isDisabled || tf->programCapture) {
+		capture_broker_update(tf, false);
 		if (tf->source) {
 			obs_source_skip_video_filter(tf->source);
 		}
 		return;
 	}
 
+	tf->counters.rendered.fetch_add(1, std::memory_order_relaxed);
+	capture_broker_update(tf, !tf->asyncFrameTap);
+
+	std::vector<cv::Rect> redacted;
+	if (tf->redactionMode != REDACTION_MODE_OFF) {
+		std::lock_guard<std::mutex> lock(tf->redactionLock);
+		redacted = tf->redactionBoxes.active(os_gettime_ns());
+	}
+
 	uint32_t width, height;
-	if (!getRGBAFromStageSurface(tf, width, height)) {
+	tf->targetRendered = !tf->asyncFrameTap;
+	if (tf->asyncFrameTap) {
+		// the frames come from ocr_filter_video, only render the output, and the target
+		// for redaction to sample from
+		obs_source_t *target = obs_filter_get_target(tf->source);
+		width = target ? obs_source_get_base_width(target) : 0;
+		height = target ? obs_source_get_base_height(target) : 0;
+		tf->targetRendered = !redacted.empty() && renderFilterTarget(tf, width, height);
+	} else if (!renderFilterTarget(tf, width, height)) {
 		if (tf->source) {
 			obs_source_skip_video_filter(tf->source);
 		}
 		return;
-	}
-
-	// if preview binarization is enabled, render the binarized image
-	if (tf->previewBinarization) {
-		gs_texture_t *tex = nullptr;
-		{
-			// lock the outputPreviewBGRALock mutex
-			std::lock_guard<std::mutex> lock(tf->outputPreviewBGRALock);
-			if (tf->outputPreviewBGRA.empty()) {
-				obs_log(LOG_ERROR, "Binarized image is empty");
-				obs_source_skip_video_filter(tf->source);
-				return;
+	} else if (tf->captureShared) {
+		// other OCR filters read the same source: one full size readback per frame is
+		// shared between them, each takes its regions and rescales on the CPU
+		gs_texture_t *rendered = gs_texrender_get_texture(tf->texrender);
+		if (!capture_broker_take(tf, obs_get_video_frame_time(),
+					 cv::Size((int)width, (int)height)) &&
+		    !getRGBAFromStageSurface(tf, rendered, width, height,
+					     cv::Size((int)width, (int)height))) {
+			draw_rendered_target(tf, width, height, redacted);
+			return;
+		}
+		if (tf->update_on_change) {
+			// keep the reference current for when the filter captures alone again
+			gpu_change_reference_update(tf, rendered, width, height);
+		}
+	} else {
+		// OCR may get a smaller copy or only the regions, the output stays at full size
+		uint32_t staged_width = width;
+		uint32_t staged_height = height;
+		gs_texture_t *staged = drawRegionsAtlas(tf, staged_width, staged_height);
+		const roi_atlas *atlas = staged ? &tf->atlas : nullptr;
+		if (!staged) {
+			staged = downscaleRenderedTarget(tf, staged_width, staged_height);
+		}
+		if (tf->update_on_change &&
+		    gpu_frame_unchanged(tf, staged, staged_width, staged_height)) {
+			// nothing for OCR to do, skip the readback
+			tf->counters.unchanged_not_staged.fetch_add(1, std::memory_order_relaxed);
+			if (!redacted.empty()) {
+				refresh_redaction(tf);
 			}
-			if ((uint32_t)tf->outputPreviewBGRA.cols != width ||
-			    (uint32_t)tf->outputPreviewBGRA.rows != height) {
-				obs_source_skip_video_filter(tf->source);
-				return;
+		} else if (getRGBAFromStageSurface(tf, staged, staged_width, staged_height,
+						   cv::Size((int)width, (int)height), atlas)) {
+			if (tf->update_on_change) {
+				gpu_change_reference_update(tf, staged, staged_width,
+							    staged_height);
 			}
+		} else {
+			draw_rendered_target(tf, width, height, redacted);
+			return;
+		}
+	}
 
-			tex = gs_texture_create(width, height, GS_RGBA, 1,
-						(const uint8_t **)&tf->outputPreviewBGRA.data, 0);
+	// if preview binarization is enabled, render the binarized image. Regions and scroll
+	// strips are binarized separately and have no preview.
+	if (tf->previewBinarization && !tf->hasRegions && tf->scrollMode == SCROLL_MODE_OFF) {
+		gs_texture_t *tex = update_preview_texture(tf);
+		if (tex == nullptr) {
+			obs_log(LOG_ERROR, "Binarized image is empty");
+			draw_rendered_target(tf, width, height, redacted);
+			return;
 		}
 
 		gs_eparam_t *imageParam = gs_effect_get_param_by_name(tf->effect, "myimage");
@@ -582,13 +1013,17 @@ void ocr_filter_video_render(void *data, gs_effect_t *_effect)
 		gs_blend_state_push();
 		gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
 
-		while (gs_effect_loop(tf->effect, "MyDraw")) {
-			gs_draw_sprite(tex, 0, 0, 0);
+		const char *technique =
+			gs_texture_get_color_format(tex) == GS_R8 ? "DrawGray" : "MyDraw";
+		// the preview is smaller than the output when rescaled on the GPU
+		while (gs_effect_loop(tf->effect, technique)) {
+			gs_draw_sprite(tex, 0, width, height);
 		}
 
 		gs_blend_state_pop();
-		gs_texture_destroy(tex);
+		tf->outputUnchanged = false;
+		draw_redaction(tf, width, height, redacted);
 	} else {
-		obs_source_skip_video_filter(tf->source);
+		draw_rendered_target(tf, width, height, redacted);
 	}
 }
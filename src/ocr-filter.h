@@ -15,8 +15,11 @@ obs_properties_t *ocr_filter_properties(void *data);
 void ocr_filter_update(void *data, obs_data_t *settings);
 void ocr_filter_activate(void *data);
 void ocr_filter_deactivate(void *data);
+void ocr_filter_show(void *data);
+void ocr_filter_hide(void *data);
 void ocr_filter_video_tick(void *data, float seconds);
 void ocr_filter_video_render(void *data, gs_effect_t *_effect);
+struct obs_source_frame *ocr_filter_video(void *data, struct obs_source_frame *frame);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,359 @@
+#include "ocr-pipeline.h"
+#include "ocr-trace.h"
+#include "simd-kernels.h"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+const char *ocr_pipeline_stage_name(int stage)
+{
+	switch (stage) {
+	case OCR_STAGE_CHANGE_DETECTION:
+		return "change_detection";
+	case OCR_STAGE_BINARIZATION:
+		return "binarization";
+	case OCR_STAGE_DILATION:
+		return "dilation";
+	case OCR_STAGE_RESCALE:
+		return "rescale";
+	case OCR_STAGE_RECOGNITION:
+		return "recognition";
+	case OCR_STAGE_DETECTION_BOXES:
+		return "detection_boxes";
+	default:
+		return "unknown";
+	}
+}
+
+tesseract::TessBaseAPI *create_tesseract_model(const char *tessdata_path,
+					       const std::string &language, char **configs,
+					       int configs_size)
+{
+	tesseract::TessBaseAPI *model = new tesseract::TessBaseAPI();
+
+	// Load model
+	int retval = model->Init(tessdata_path, language.c_str(), tesseract::OEM_LSTM_ONLY, configs,
+				 configs_size, nullptr, nullptr, false);
+	if (retval != 0) {
+		delete model;
+		throw std::runtime_error("Failed to initialize tesseract model");
+	}
+	return model;
+}
+
+void apply_tesseract_settings(tesseract::TessBaseAPI *model, int page_segmentation_mode,
+			      const std::string &char_whitelist)
+{
+	// set tesseract page segmentation mode
+	model->SetPageSegMode(static_cast<tesseract::PageSegMode>(page_segmentation_mode));
+
+	// apply char whitlist
+	model->SetVariable("tessedit_char_whitelist", char_whitelist.c_str());
+}
+
+void to_grayscale(const cv::Mat &image, cv::Mat &gray)
+{
+	if (image.channels() == 1) {
+		gray = image;
+	} else {
+		bgra_to_gray(image, gray);
+	}
+}
+
+bool image_has_changed(const cv::Mat &image, const cv::Mat &lastImage,
+		       int update_on_change_threshold)
+{
+	OCR_TRACE_SPAN("change_detection");
+	cv::Mat current = image;
+	if (image.channels() == 4 && lastImage.channels() == 1) {
+		bgra_to_gray(image, current);
+	}
+	if (current.size() != lastImage.size() || current.type() != lastImage.type()) {
+		return true;
+	}
+	const float image_area = (float)(image.cols * image.rows);
+	const int change_threshold_from_image_area =
+		(int)((float)update_on_change_threshold / 100.0f * image_area);
+	// the pixels whose absolute difference is not zero in grayscale, without storing the
+	// difference
+	return count_changed_pixels(current, lastImage) >=
+	       (uint64_t)std::max(0, change_threshold_from_image_area);
+}
+
+bool preprocess_accepts_gray(const ocr_pipeline_settings &settings)
+{
+	return settings.binarizationMode != 0;
+}
+
+cv::Mat preprocess_image(const cv::Mat &imageBGRA, const ocr_pipeline_settings &settings,
+			 cv::Mat *preview, ocr_stage_timings *timings)
+{
+	cv::Mat imageForOCR = imageBGRA;
+	uint64_t stage_start_ns = get_time_ns();
+
+	// if threshold is requested, apply it
+	if (settings.binarizationMode != 0) {
+		OCR_TRACE_SPAN("binarization");
+		// a new image, the input may be shared with the capture
+		cv::Mat binary;
+		// the global thresholds convert BGRA themselves, a fixed one without a whole
+		// grayscale image
+		if (settings.binarizationMode == 1)
+			binarize_global(imageForOCR, binary, GLOBAL_THRESHOLD_FIXED,
+					settings.binarizationThreshold);
+		else if (settings.binarizationMode == 4)
+			binarize_global(imageForOCR, binary, GLOBAL_THRESHOLD_TRIANGLE, 0);
+		else if (settings.binarizationMode == 5)
+			binarize_global(imageForOCR, binary, GLOBAL_THRESHOLD_OTSU, 0);
+		else if (settings.binarizationMode == 2 || settings.binarizationMode == 3) {
+			// ensure that the block size is odd
+			int block_size = settings.binarizationBlockSize;
+			if (settings.binarizationBlockSize % 2 == 0) {
+				block_size++;
+			}
+			cv::Mat gray;
+			to_grayscale(imageForOCR, gray);
+			cv::adaptiveThreshold(gray, binary, 255,
+					      settings.binarizationMode == 2
+						      ? cv::ADAPTIVE_THRESH_MEAN_C
+						      : cv::ADAPTIVE_THRESH_GAUSSIAN_C,
+					      cv::THRESH_BINARY, block_size, 2);
+		}
+		if (!binary.empty()) {
+			imageForOCR = binary;
+		}
+	}
+	if (timings) {
+		const uint64_t now_ns = get_time_ns();
+		timings->stage_ns[OCR_STAGE_BINARIZATION] = now_ns - stage_start_ns;
+		stage_start_ns = now_ns;
+	}
+
+	if (settings.dilationIterations > 0) {
+		OCR_TRACE_SPAN("dilation");
+		cv::Mat dilated;
+		dilate_3x3(imageForOCR, dilated, settings.dilationIterations);
+		imageForOCR = dilated;
+	}
+	if (timings) {
+		const uint64_t now_ns = get_time_ns();
+		timings->stage_ns[OCR_STAGE_DILATION] = now_ns - stage_start_ns;
+		stage_start_ns = now_ns;
+	}
+
+	if (preview != nullptr) {
+		// shared, not copied: nothing below writes into imageForOCR
+		*preview = imageForOCR;
+	}
+
+	// the frame may already be at the target size when it was downscaled on capture
+	if (settings.rescaleImage && imageForOCR.rows != settings.rescaleTargetSize) {
+		OCR_TRACE_SPAN("rescale");
+		// scale to height settings.rescaleTargetSize maintaining aspect ratio
+		cv::Mat resized;
+		float scale = (float)settings.rescaleTargetSize / (float)imageForOCR.rows;
+		cv::resize(imageForOCR, resized, cv::Size(), scale, scale);
+		imageForOCR = resized;
+	}
+	if (timings) {
+		timings->stage_ns[OCR_STAGE_RESCALE] = get_time_ns() - stage_start_ns;
+	}
+
+	return imageForOCR;
+}
+
+void scale_boxes(std::vector<OCRBox> &boxes, cv::Size from, cv::Size to)
+{
+	if (from == to || from.empty()) {
+		return;
+	}
+	const double scale_x = (double)to.width / (double)from.width;
+	const double scale_y = (double)to.height / (double)from.height;
+	for (auto &box : boxes) {
+		box.box = cv::Rect(cvRound(box.box.x * scale_x), cvRound(box.box.y * scale_y),
+				   cvRound(box.box.width * scale_x),
+				   cvRound(box.box.height * scale_y));
+	}
+}
+
+std::string strip(const std::string &str)
+{
+	size_t start = str.find_first_not_of(" \t\n\r");
+	size_t end = str.find_last_not_of(" \t\n\r");
+
+	if (start == std::string::npos || end == std::string::npos)
+		return "";
+
+	return str.substr(start, end - start + 1);
+}
+
+// Give the image to the model, a binarized image as one bit per pixel: 8 times less to copy
+// and Tesseract does not threshold it again
+static void set_model_image(tesseract::TessBaseAPI *model, const cv::Mat &image)
+{
+	thread_local std::vector<uint8_t> bits;
+	int bytes_per_line = 0;
+	if (image.channels() == 1 && pack_binary(image, bits, bytes_per_line)) {
+		model->SetImage(bits.data(), image.cols, image.rows, 0, bytes_per_line);
+	} else {
+		model->SetImage(image.data, image.cols, image.rows, image.channels(),
+				(int)image.step);
+	}
+}
+
+// Boxes too small to hold text or covering most of the image are noise
+static bool is_text_box_size(int left, int top, int right, int bottom, cv::Size imageSize)
+{
+	const int area = (right - left) * (bottom - top);
+	return area >= 100 && area <= (imageSize.width * imageSize.height) / 2;
+}
+
+std::string recognize_text(tesseract::TessBaseAPI *model, const cv::Mat &image,
+			   int conf_threshold, int *confidence)
+{
+	OCR_TRACE_SPAN("recognition");
+	set_model_image(model, image);
+	char *text = model->GetUTF8Text();
+	if (text == nullptr) {
+		if (confidence != nullptr) {
+			*confidence = 0;
+		}
+		return "";
+	}
+	std::string recognitionResult = std::string(text);
+	delete[] text;
+
+	// get the confidence of the recognition result
+	const int meanConfidence = model->MeanTextConf();
+	if (confidence != nullptr) {
+		*confidence = meanConfidence;
+	}
+
+	if (meanConfidence < conf_threshold) {
+		return "";
+	}
+
+	// strip whitespace from the beginning and end of the string
+	return strip(recognitionResult);
+}
+
+std::vector<OCRBox> get_text_detection_boxes(tesseract::TessBaseAPI *model,
+					     int page_segmentation_mode, int conf_threshold,
+					     cv::Size imageSize)
+{
+	OCR_TRACE_SPAN("detection_boxes");
+	// extract the text detection boxes
+	tesseract::ResultIterator *ri = model->GetIterator();
+	if (ri == nullptr) {
+		return std::vector<OCRBox>();
+	}
+	tesseract::PageIteratorLevel level = tesseract::RIL_WORD;
+	if (page_segmentation_mode == tesseract::PSM_SINGLE_CHAR) {
+		level = tesseract::RIL_SYMBOL;
+	}
+	std::vector<OCRBox> boxes;
+	do {
+		if (ri->Empty(level)) {
+			continue;
+		}
+		// is this a word box?
+		if (level == tesseract::RIL_WORD) {
+			// get the confidence of the word
+			float conf = ri->Confidence(level);
+			if ((int)conf < conf_threshold) {
+				continue;
+			}
+		}
+		int left, top, right, bottom;
+		ri->BoundingBox(level, &left, &top, &right, &bottom);
+		if (!is_text_box_size(left, top, right, bottom, imageSize)) {
+			continue;
+		}
+		OCRBox box;
+		box.box = cv::Rect(left, top, right - left, bottom - top);
+		// get the text of the box
+		char *text = ri->GetUTF8Text(level);
+		if (text != nullptr) {
+			box.text = text;
+			delete[] text;
+		}
+		boxes.push_back(box);
+	} while (ri->Next(level));
+	delete ri;
+
+	return boxes;
+}
+
+std::vector<OCRBox> detect_layout_boxes(tesseract::TessBaseAPI *model, const cv::Mat &image,
+					int page_segmentation_mode)
+{
+	OCR_TRACE_SPAN("layout_analysis");
+	set_model_image(model, image);
+	std::vector<OCRBox> boxes;
+	tesseract::PageIterator *it = model->AnalyseLayout();
+	if (it == nullptr) {
+		return boxes;
+	}
+	tesseract::PageIteratorLevel level = tesseract::RIL_WORD;
+	if (page_segmentation_mode == tesseract::PSM_SINGLE_CHAR) {
+		level = tesseract::RIL_SYMBOL;
+	}
+	do {
+		if (it->Empty(level)) {
+			continue;
+		}
+		int left, top, right, bottom;
+		it->BoundingBox(level, &left, &top, &right, &bottom);
+		if (!is_text_box_size(left, top, right, bottom, image.size())) {
+			continue;
+		}
+		OCRBox box;
+		box.box = cv::Rect(left, top, right - left, bottom - top);
+		boxes.push_back(box);
+	} while (it->Next(level));
+	delete it;
+
+	return boxes;
+}
+
+CharacterBasedSmoothingFilter::CharacterBasedSmoothingFilter(size_t word_length_,
+							     size_t window_size_)
+	: word_length(word_length_),
+	  window_size(window_size_),
+	  readings(word_length_, std::deque<char>(window_size_))
+{
+}
+
+std::string CharacterBasedSmoothingFilter::add_reading(const std::string &inWord)
+{
+	std::string word = inWord;
+	if (word.length() != word_length) {
+		// trim the word if it's longer than the expected length
+		if (word.length() > this->word_length)
+			word = word.substr(0, this->word_length);
+		// pad the word if it's shorter than the expected length
+		if (word.length() < this->word_length)
+			word = word + std::string(this->word_length - word.length(), ' ');
+	}
+
+	std::string smoothed_word;
+	for (size_t i = 0; i < word_length; i++) {
+		readings[i].push_back(word[i]);
+		if (readings[i].size() > window_size) {
+			readings[i].pop_front();
+		}
+		std::string window(readings[i].begin(), readings[i].end());
+		// find the most common character in the window
+		char most_common_char =
+			*std::max_element(window.begin(), window.end(), [window](char a, char b) {
+				return std::count(window.begin(), window.end(), a) <
+				       std::count(window.begin(), window.end(), b);
+			});
+		smoothed_word += most_common_char;
+	}
+
+	return smoothed_word;
+}
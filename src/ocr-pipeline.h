@@ -0,0 +1,130 @@
+#ifndef OCR_PIPELINE_H
+#define OCR_PIPELINE_H
+
+// The OCR pipeline proper: change detection, preprocessing, recognition and box extraction.
+// This header must stay free of OBS types so the pipeline can also run headless, e.g. in
+// the offline benchmark tool.
+
+#include <opencv2/core/mat.hpp>
+
+#include <tesseract/baseapi.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+struct OCRBox {
+	std::string text;
+	cv::Rect box;
+};
+
+/**
+  * @brief The settings that affect OCR processing.
+  *
+  * Default values match ocr_filter_defaults.
+*/
+struct ocr_pipeline_settings {
+	std::string language = "eng";
+	int pageSegmentationMode = tesseract::PSM_AUTO;
+	int binarizationMode = 0;
+	int binarizationThreshold = 127;
+	int binarizationBlockSize = 15;
+	int dilationIterations = 0;
+	bool rescaleImage = false;
+	int rescaleTargetSize = 35;
+	std::string char_whitelist;
+	int conf_threshold = 50;
+	bool enable_smoothing = false;
+	size_t word_length = 5;
+	size_t window_size = 10;
+	bool update_on_change = true;
+	int update_on_change_threshold = 15;
+};
+
+enum ocr_pipeline_stage {
+	OCR_STAGE_CHANGE_DETECTION = 0,
+	OCR_STAGE_BINARIZATION,
+	OCR_STAGE_DILATION,
+	OCR_STAGE_RESCALE,
+	OCR_STAGE_RECOGNITION,
+	OCR_STAGE_DETECTION_BOXES,
+	OCR_STAGE_COUNT
+};
+
+const char *ocr_pipeline_stage_name(int stage);
+
+/**
+  * @brief Time spent in each pipeline stage for one frame, in nanoseconds
+*/
+struct ocr_stage_timings {
+	uint64_t stage_ns[OCR_STAGE_COUNT] = {0};
+};
+
+inline uint64_t mat_bytes(const cv::Mat &mat)
+{
+	return (uint64_t)mat.total() * mat.elemSize();
+}
+
+inline uint64_t get_time_ns(void)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		       std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+tesseract::TessBaseAPI *create_tesseract_model(const char *tessdata_path,
+					       const std::string &language, char **configs,
+					       int configs_size);
+void apply_tesseract_settings(tesseract::TessBaseAPI *model, int page_segmentation_mode,
+			      const std::string &char_whitelist);
+
+// Convert a BGRA image to grayscale, a grayscale image is shared as is
+void to_grayscale(const cv::Mat &image, cv::Mat &gray);
+
+// Images are BGRA or grayscale. lastImage may be a grayscale copy of the previous BGRA frame,
+// to save memory
+bool image_has_changed(const cv::Mat &image, const cv::Mat &lastImage,
+		       int update_on_change_threshold);
+/**
+  * @brief Whether preprocess_image gives the same image for the grayscale of a frame as for
+  * the BGRA frame itself, so the capture may convert it while copying it out.
+  *
+  * Only binarization starts with the same grayscale conversion. Without it Tesseract gets the
+  * color image, and dilation works on each channel.
+*/
+bool preprocess_accepts_gray(const ocr_pipeline_settings &settings);
+// preview, if given, shares the image before the rescale: grayscale once binarized
+cv::Mat preprocess_image(const cv::Mat &imageBGRA, const ocr_pipeline_settings &settings,
+			 cv::Mat *preview = nullptr, ocr_stage_timings *timings = nullptr);
+std::string recognize_text(tesseract::TessBaseAPI *model, const cv::Mat &image,
+			   int conf_threshold, int *confidence = nullptr);
+std::vector<OCRBox> get_text_detection_boxes(tesseract::TessBaseAPI *model,
+					     int page_segmentation_mode, int conf_threshold,
+					     cv::Size imageSize);
+/**
+  * @brief Find the word boxes of the image with layout analysis only, without recognizing
+  * the text: several times faster when only the boxes are needed.
+  *
+  * The boxes have no text and no confidence, so the confidence threshold does not apply.
+*/
+std::vector<OCRBox> detect_layout_boxes(tesseract::TessBaseAPI *model, const cv::Mat &image,
+					int page_segmentation_mode);
+// Scale boxes found in an image of size from to an image of size to
+void scale_boxes(std::vector<OCRBox> &boxes, cv::Size from, cv::Size to);
+std::string strip(const std::string &str);
+
+class CharacterBasedSmoothingFilter {
+public:
+	CharacterBasedSmoothingFilter(size_t word_length, size_t window_size = 10);
+
+	std::string add_reading(const std::string &word);
+
+private:
+	size_t word_length;
+	size_t window_size;
+	std::vector<std::deque<char>> readings;
+};
+
+#endif /* OCR_PIPELINE_H */
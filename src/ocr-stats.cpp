@@ -0,0 +1,213 @@
+#include "ocr-stats.h"
+
+#include <cstdio>
+#include <limits>
+
+namespace {
+
+const double BUCKET_UPPER_MS[latency_histogram::BUCKET_COUNT] = {
+	1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000,
+	std::numeric_limits<double>::infinity()};
+
+std::atomic<uint64_t> memory_total_bytes{0};
+std::atomic<uint64_t> memory_budget_bytes{0};
+
+} // namespace
+
+double latency_histogram::bucket_upper_ms(int bucket)
+{
+	return BUCKET_UPPER_MS[bucket];
+}
+
+void latency_histogram::record(uint64_t latency_ns)
+{
+	const double latency_ms = (double)latency_ns / 1e6;
+	int bucket = 0;
+	while (bucket < BUCKET_COUNT - 1 && latency_ms > BUCKET_UPPER_MS[bucket]) {
+		bucket++;
+	}
+	buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	total_count.fetch_add(1, std::memory_order_relaxed);
+	total_ns.fetch_add(latency_ns, std::memory_order_relaxed);
+
+	uint64_t current_max = maximum_ns.load(std::memory_order_relaxed);
+	while (latency_ns > current_max &&
+	       !maximum_ns.compare_exchange_weak(current_max, latency_ns,
+						 std::memory_order_relaxed)) {
+	}
+}
+
+void latency_histogram::reset()
+{
+	for (auto &bucket : buckets) {
+		bucket.store(0, std::memory_order_relaxed);
+	}
+	total_count.store(0, std::memory_order_relaxed);
+	total_ns.store(0, std::memory_order_relaxed);
+	maximum_ns.store(0, std::memory_order_relaxed);
+}
+
+double latency_histogram::mean_ms() const
+{
+	const uint64_t n = count();
+	return n == 0 ? 0.0 : (double)total_ns.load(std::memory_order_relaxed) / (double)n / 1e6;
+}
+
+double latency_histogram::max_ms() const
+{
+	return (double)maximum_ns.load(std::memory_order_relaxed) / 1e6;
+}
+
+double latency_histogram::percentile_ms(double p) const
+{
+	const uint64_t n = count();
+	if (n == 0) {
+		return 0.0;
+	}
+	const uint64_t target = (uint64_t)(p * (double)n + 0.5);
+	uint64_t seen = 0;
+	for (int bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+		seen += buckets[bucket].load(std::memory_order_relaxed);
+		if (seen >= target && seen > 0) {
+			// the open-ended last bucket is reported by the maximum
+			return bucket == BUCKET_COUNT - 1 ? max_ms() : BUCKET_UPPER_MS[bucket];
+		}
+	}
+	return max_ms();
+}
+
+std::string latency_histogram::summary() const
+{
+	char buffer[160];
+	snprintf(buffer, sizeof(buffer),
+		 "n=%llu mean=%.1fms p50<=%.0fms p90<=%.0fms p99<=%.0fms max=%.1fms",
+		 (unsigned long long)count(), mean_ms(), percentile_ms(0.5), percentile_ms(0.9),
+		 percentile_ms(0.99), max_ms());
+	return buffer;
+}
+
+uint64_t frame_counters::dropped() const
+{
+	const uint64_t staged_frames = staged.load(std::memory_order_relaxed);
+	const uint64_t consumed_frames = consumed.load(std::memory_order_relaxed);
+	return staged_frames > consumed_frames ? staged_frames - consumed_frames : 0;
+}
+
+void frame_counters::reset()
+{
+	for (std::atomic<uint64_t> *counter :
+	     {&rendered, &staged, &unchanged_not_staged, &shared_captures, &consumed,
+	      &handoff_missed, &skipped_unchanged, &rejected_low_confidence, &empty_results,
+	      &scroll_strips, &tracked_frames, &layout_only}) {
+		counter->store(0, std::memory_order_relaxed);
+	}
+}
+
+std::string frame_counters::summary() const
+{
+	char buffer[384];
+	snprintf(buffer, sizeof(buffer),
+		 "rendered=%llu staged=%llu not_staged=%llu shared=%llu consumed=%llu dropped=%llu "
+		 "handoff_missed=%llu unchanged=%llu low_confidence=%llu empty=%llu strips=%llu "
+		 "tracked=%llu layout_only=%llu",
+		 (unsigned long long)rendered.load(std::memory_order_relaxed),
+		 (unsigned long long)staged.load(std::memory_order_relaxed),
+		 (unsigned long long)unchanged_not_staged.load(std::memory_order_relaxed),
+		 (unsigned long long)shared_captures.load(std::memory_order_relaxed),
+		 (unsigned long long)consumed.load(std::memory_order_relaxed),
+		 (unsigned long long)dropped(),
+		 (unsigned long long)handoff_missed.load(std::memory_order_relaxed),
+		 (unsigned long long)skipped_unchanged.load(std::memory_order_relaxed),
+		 (unsigned long long)rejected_low_confidence.load(std::memory_order_relaxed),
+		 (unsigned long long)empty_results.load(std::memory_order_relaxed),
+		 (unsigned long long)scroll_strips.load(std::memory_order_relaxed),
+		 (unsigned long long)tracked_frames.load(std::memory_order_relaxed),
+		 (unsigned long long)layout_only.load(std::memory_order_relaxed));
+	return buffer;
+}
+
+const char *ocr_memory_category_name(int category)
+{
+	switch (category) {
+	case OCR_MEMORY_INPUT_FRAME:
+		return "input_frame";
+	case OCR_MEMORY_CHANGE_REFERENCE:
+		return "change_reference";
+	case OCR_MEMORY_PREVIEW:
+		return "preview";
+	case OCR_MEMORY_PIPELINE:
+		return "pipeline";
+	case OCR_MEMORY_ARENA_POOL:
+		return "arena_pool";
+	default:
+		return "unknown";
+	}
+}
+
+memory_usage::~memory_usage()
+{
+	for (int category = 0; category < OCR_MEMORY_CATEGORY_COUNT; category++) {
+		set(category, 0);
+	}
+}
+
+void memory_usage::set(int category, uint64_t new_bytes)
+{
+	const uint64_t old_bytes = bytes[category].exchange(new_bytes, std::memory_order_relaxed);
+	if (old_bytes != new_bytes) {
+		ocr_memory_adjust_total((int64_t)new_bytes - (int64_t)old_bytes);
+	}
+}
+
+uint64_t memory_usage::get(int category) const
+{
+	return bytes[category].load(std::memory_order_relaxed);
+}
+
+uint64_t memory_usage::total() const
+{
+	uint64_t sum = 0;
+	for (int category = 0; category < OCR_MEMORY_CATEGORY_COUNT; category++) {
+		sum += get(category);
+	}
+	return sum;
+}
+
+std::string memory_usage::summary() const
+{
+	std::string result;
+	char buffer[64];
+	for (int category = 0; category < OCR_MEMORY_CATEGORY_COUNT; category++) {
+		snprintf(buffer, sizeof(buffer), "%s%s=%.1fMB", category == 0 ? "" : " ",
+			 ocr_memory_category_name(category),
+			 (double)get(category) / (1024.0 * 1024.0));
+		result += buffer;
+	}
+	return result;
+}
+
+void ocr_memory_adjust_total(int64_t delta_bytes)
+{
+	memory_total_bytes.fetch_add((uint64_t)delta_bytes, std::memory_order_relaxed);
+}
+
+uint64_t ocr_memory_total_bytes()
+{
+	return memory_total_bytes.load(std::memory_order_relaxed);
+}
+
+void ocr_memory_set_budget(uint64_t budget_bytes)
+{
+	memory_budget_bytes.store(budget_bytes, std::memory_order_relaxed);
+}
+
+uint64_t ocr_memory_budget()
+{
+	return memory_budget_bytes.load(std::memory_order_relaxed);
+}
+
+bool ocr_memory_over_budget()
+{
+	const uint64_t budget = ocr_memory_budget();
+	return budget > 0 && ocr_memory_total_bytes() > budget;
+}
@@ -0,0 +1,121 @@
+#ifndef OCR_STATS_H
+#define OCR_STATS_H
+
+// Runtime statistics of the OCR pipeline. Free of OBS types so they can be shared with the
+// benchmark tool.
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/**
+  * @brief Lock-free histogram of latencies with fixed, roughly logarithmic buckets.
+  *
+  * Safe to record from one thread while others read; percentiles are approximate (upper bound
+  * of the bucket the percentile falls in).
+*/
+class latency_histogram {
+public:
+	static const int BUCKET_COUNT = 14;
+
+	void record(uint64_t latency_ns);
+	void reset();
+	uint64_t count() const { return total_count.load(std::memory_order_relaxed); }
+	double mean_ms() const;
+	double max_ms() const;
+	double percentile_ms(double p) const;
+	// e.g. "n=120 mean=85.2ms p50<=100ms p90<=200ms p99<=200ms max=143.9ms"
+	std::string summary() const;
+
+	// Upper bound of a bucket in milliseconds, the last bucket is unbounded
+	static double bucket_upper_ms(int bucket);
+
+private:
+	std::atomic<uint64_t> buckets[BUCKET_COUNT] = {};
+	std::atomic<uint64_t> total_count{0};
+	std::atomic<uint64_t> total_ns{0};
+	std::atomic<uint64_t> maximum_ns{0};
+};
+
+/**
+  * @brief Counters of where the frames of a filter go, from rendering to the sinks.
+  *
+  * Each counter is written by a single thread (render or worker) and read by anyone.
+*/
+struct frame_counters {
+	// render thread: video_render calls while enabled, frames copied for the worker and
+	// frames not copied because the GPU change detection found them unchanged
+	std::atomic<uint64_t> rendered{0};
+	std::atomic<uint64_t> staged{0};
+	std::atomic<uint64_t> unchanged_not_staged{0};
+	// render thread: frames taken from the readback of another filter on the same source
+	std::atomic<uint64_t> shared_captures{0};
+	// worker thread: new frames picked up, and iterations where the render thread held the
+	// input lock
+	std::atomic<uint64_t> consumed{0};
+	std::atomic<uint64_t> handoff_missed{0};
+	// worker thread: frames rejected by the change detector, results below the confidence
+	// threshold and empty results
+	std::atomic<uint64_t> skipped_unchanged{0};
+	std::atomic<uint64_t> rejected_low_confidence{0};
+	std::atomic<uint64_t> empty_results{0};
+	// worker thread: scroll mode recognitions of only the newly revealed strip
+	std::atomic<uint64_t> scroll_strips{0};
+	// worker thread: frames where box tracking found all boxes
+	std::atomic<uint64_t> tracked_frames{0};
+	// worker thread: frames whose boxes were found by layout analysis alone, without
+	// recognition, because no output needs their text
+	std::atomic<uint64_t> layout_only{0};
+
+	// Staged frames overwritten before the worker picked them up
+	uint64_t dropped() const;
+	void reset();
+	// e.g. "rendered=600 staged=40 not_staged=560 shared=0 consumed=20 dropped=20 ..."
+	std::string summary() const;
+};
+
+enum ocr_memory_category {
+	// the frame copied from the render thread
+	OCR_MEMORY_INPUT_FRAME = 0,
+	// the previous frame kept for change detection
+	OCR_MEMORY_CHANGE_REFERENCE,
+	// the binarization preview shown in place of the source
+	OCR_MEMORY_PREVIEW,
+	// the worker's copy of the frame and the preprocessed images of the last iteration
+	OCR_MEMORY_PIPELINE,
+	// released pipeline buffers kept for reuse by the next iteration
+	OCR_MEMORY_ARENA_POOL,
+	OCR_MEMORY_CATEGORY_COUNT
+};
+
+const char *ocr_memory_category_name(int category);
+
+/**
+  * @brief Bytes held by one filter, by category.
+  *
+  * Every change is also applied to the process-wide total returned by ocr_memory_total_bytes,
+  * which is what the memory budget is checked against.
+*/
+class memory_usage {
+public:
+	~memory_usage();
+
+	void set(int category, uint64_t bytes);
+	uint64_t get(int category) const;
+	uint64_t total() const;
+	// e.g. "input_frame=8.3MB change_reference=2.1MB preview=0.0MB pipeline=10.4MB"
+	std::string summary() const;
+
+private:
+	std::atomic<uint64_t> bytes[OCR_MEMORY_CATEGORY_COUNT] = {};
+};
+
+// Process-wide accounting of the bytes held by all filters and models
+void ocr_memory_adjust_total(int64_t delta_bytes);
+uint64_t ocr_memory_total_bytes();
+// A budget of 0 means unlimited
+void ocr_memory_set_budget(uint64_t budget_bytes);
+uint64_t ocr_memory_budget();
+bool ocr_memory_over_budget();
+
+#endif /* OCR_STATS_H */
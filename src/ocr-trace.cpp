@@ -0,0 +1,207 @@
+#include "ocr-trace.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<int> ocr_trace_users{0};
+
+namespace {
+
+const size_t TRACE_BUFFER_CAPACITY = 16384;
+// exited thread buffers are pruned once there are more than this many buffers
+const size_t TRACE_MAX_BUFFERS = 64;
+
+struct trace_event {
+	std::atomic<const char *> name{nullptr};
+	std::atomic<uint64_t> start_ns{0};
+	std::atomic<uint64_t> end_ns{0};
+};
+
+/**
+  * @brief Single-producer ring of events, written only by its owning thread.
+  *
+  * The reader copies events and then re-reads the write index to discard any slot the writer
+  * may have overwritten, or may be writing, in the meantime, so neither side ever blocks.
+*/
+struct trace_thread_buffer {
+	uint32_t tid = 0;
+	std::atomic<bool> exited{false};
+	std::mutex name_mutex;
+	std::string thread_name;
+	std::atomic<uint64_t> write_index{0};
+	std::array<trace_event, TRACE_BUFFER_CAPACITY> events;
+};
+
+std::mutex registry_mutex;
+std::vector<std::shared_ptr<trace_thread_buffer>> registry;
+uint32_t next_tid = 1;
+
+struct trace_thread_holder {
+	std::shared_ptr<trace_thread_buffer> buffer;
+	~trace_thread_holder()
+	{
+		if (buffer) {
+			buffer->exited.store(true, std::memory_order_relaxed);
+		}
+	}
+};
+
+thread_local trace_thread_holder tls_holder;
+
+trace_thread_buffer *get_thread_buffer()
+{
+	if (tls_holder.buffer) {
+		return tls_holder.buffer.get();
+	}
+	auto buffer = std::make_shared<trace_thread_buffer>();
+	{
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		if (registry.size() >= TRACE_MAX_BUFFERS) {
+			std::vector<std::shared_ptr<trace_thread_buffer>> alive;
+			for (auto &b : registry) {
+				if (!b->exited.load(std::memory_order_relaxed)) {
+					alive.push_back(b);
+				}
+			}
+			registry.swap(alive);
+		}
+		buffer->tid = next_tid++;
+		registry.push_back(buffer);
+	}
+	tls_holder.buffer = buffer;
+	return buffer.get();
+}
+
+void write_json_string(FILE *file, const std::string &str)
+{
+	fputc('"', file);
+	for (char c : str) {
+		if (c == '"' || c == '\\') {
+			fputc('\\', file);
+			fputc(c, file);
+		} else if ((unsigned char)c < 0x20) {
+			fprintf(file, "\\u%04x", (unsigned int)c);
+		} else {
+			fputc(c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+} // namespace
+
+void ocr_trace_enable()
+{
+	ocr_trace_users.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ocr_trace_disable()
+{
+	ocr_trace_users.fetch_sub(1, std::memory_order_relaxed);
+}
+
+uint64_t ocr_trace_now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		       std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+void ocr_trace_record(const char *name, uint64_t start_ns, uint64_t end_ns)
+{
+	trace_thread_buffer *buffer = get_thread_buffer();
+	const uint64_t index = buffer->write_index.load(std::memory_order_relaxed);
+	trace_event &event = buffer->events[index % TRACE_BUFFER_CAPACITY];
+	event.name.store(name, std::memory_order_relaxed);
+	event.start_ns.store(start_ns, std::memory_order_relaxed);
+	event.end_ns.store(end_ns, std::memory_order_relaxed);
+	buffer->write_index.store(index + 1, std::memory_order_release);
+}
+
+void ocr_trace_set_thread_name(const std::string &name)
+{
+	trace_thread_buffer *buffer = get_thread_buffer();
+	std::lock_guard<std::mutex> lock(buffer->name_mutex);
+	buffer->thread_name = name;
+}
+
+bool ocr_trace_dump(const std::string &path)
+{
+	std::vector<std::shared_ptr<trace_thread_buffer>> buffers;
+	{
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		buffers = registry;
+	}
+
+	FILE *file = fopen(path.c_str(), "w");
+	if (file == nullptr) {
+		return false;
+	}
+
+	struct copied_event {
+		const char *name;
+		uint64_t start_ns;
+		uint64_t end_ns;
+	};
+	std::vector<copied_event> events;
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	bool first = true;
+	for (const auto &buffer : buffers) {
+		{
+			std::lock_guard<std::mutex> lock(buffer->name_mutex);
+			if (!buffer->thread_name.empty()) {
+				fprintf(file,
+					"%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+					"\"tid\":%u,\"args\":{\"name\":",
+					first ? "" : ",", buffer->tid);
+				write_json_string(file, buffer->thread_name);
+				fprintf(file, "}}");
+				first = false;
+			}
+		}
+
+		const uint64_t end_index = buffer->write_index.load(std::memory_order_acquire);
+		const uint64_t begin_index = end_index > TRACE_BUFFER_CAPACITY
+						     ? end_index - TRACE_BUFFER_CAPACITY
+						     : 0;
+		events.clear();
+		for (uint64_t i = begin_index; i < end_index; i++) {
+			const trace_event &event = buffer->events[i % TRACE_BUFFER_CAPACITY];
+			events.push_back({event.name.load(std::memory_order_relaxed),
+					  event.start_ns.load(std::memory_order_relaxed),
+					  event.end_ns.load(std::memory_order_relaxed)});
+		}
+		// drop the slots the writer may have overwritten while we were copying. With a full
+		// ring the oldest slot is also the one the writer fills next, and it may be half
+		// written before write_index moves
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const uint64_t written_since =
+			buffer->write_index.load(std::memory_order_relaxed) - end_index;
+		const uint64_t in_progress = end_index >= TRACE_BUFFER_CAPACITY ? 1 : 0;
+		const size_t skip =
+			(size_t)std::min<uint64_t>(written_since + in_progress, events.size());
+
+		for (size_t i = skip; i < events.size(); i++) {
+			const copied_event &event = events[i];
+			if (event.name == nullptr) {
+				continue;
+			}
+			fprintf(file,
+				"%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+				"\"ts\":%.3f,\"dur\":%.3f}",
+				first ? "" : ",", event.name, buffer->tid,
+				(double)event.start_ns / 1000.0,
+				(double)(event.end_ns - event.start_ns) / 1000.0);
+			first = false;
+		}
+	}
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	return true;
+}
@@ -0,0 +1,56 @@
+#ifndef OCR_TRACE_H
+#define OCR_TRACE_H
+
+// Opt-in tracing of pipeline spans, exported as Chrome trace-event JSON (chrome://tracing,
+// Perfetto). Each thread records into its own lock-free ring buffer; when tracing is off a
+// span costs a single relaxed load and branch.
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+extern std::atomic<int> ocr_trace_users;
+
+inline bool ocr_trace_enabled()
+{
+	return ocr_trace_users.load(std::memory_order_relaxed) > 0;
+}
+
+// Tracing stays on while at least one user (e.g. a filter) has it enabled
+void ocr_trace_enable();
+void ocr_trace_disable();
+
+uint64_t ocr_trace_now_ns();
+// name must be a string literal, or otherwise outlive the trace buffers
+void ocr_trace_record(const char *name, uint64_t start_ns, uint64_t end_ns);
+void ocr_trace_set_thread_name(const std::string &name);
+// Write the events currently held in all thread buffers, oldest first
+bool ocr_trace_dump(const std::string &path);
+
+class ocr_trace_span {
+public:
+	explicit ocr_trace_span(const char *name_)
+		: name(ocr_trace_enabled() ? name_ : nullptr),
+		  start_ns(name ? ocr_trace_now_ns() : 0)
+	{
+	}
+	~ocr_trace_span()
+	{
+		if (name) {
+			ocr_trace_record(name, start_ns, ocr_trace_now_ns());
+		}
+	}
+	ocr_trace_span(const ocr_trace_span &) = delete;
+	ocr_trace_span &operator=(const ocr_trace_span &) = delete;
+
+private:
+	const char *name;
+	uint64_t start_ns;
+};
+
+#define OCR_TRACE_CONCAT_INNER(a, b) a##b
+#define OCR_TRACE_CONCAT(a, b) OCR_TRACE_CONCAT_INNER(a, b)
+// Trace the enclosing scope
+#define OCR_TRACE_SPAN(name) ocr_trace_span OCR_TRACE_CONCAT(ocr_trace_span_, __LINE__)(name)
+
+#endif /* OCR_TRACE_H */
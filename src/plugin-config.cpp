@@ -0,0 +1,196 @@
+#include "plugin-config.h"
+#include "plugin-support.h"
+#include "obs-utils.h"
+#include "ocr-stats.h"
+
+#include <obs-module.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// how many recently used languages are remembered for preloading
+const size_t MAX_RECENT_LANGUAGES = 4;
+
+std::mutex config_mutex;
+plugin_config config = {0, false};
+// languages are stored comma separated, a single language may be e.g. "eng+fra"
+std::vector<std::string> preload_languages;
+std::vector<std::string> recent_languages;
+
+// changes made by the filters are written on this thread, not on the UI or OCR thread that
+// made them
+std::thread save_thread;
+std::condition_variable save_cv;
+bool save_pending = false;
+bool save_stop = false;
+
+void plugin_config_defaults(obs_data_t *data)
+{
+	obs_data_set_default_int(data, "memory_budget_mb", 0);
+	obs_data_set_default_bool(data, "share_models", false);
+	obs_data_set_default_string(data, "preload_languages", "");
+	obs_data_set_default_string(data, "recent_languages", "");
+}
+
+std::vector<std::string> split_languages(const char *languages)
+{
+	std::vector<std::string> result;
+	std::stringstream stream(languages != nullptr ? languages : "");
+	std::string language;
+	while (std::getline(stream, language, ',')) {
+		if (!language.empty()) {
+			result.push_back(language);
+		}
+	}
+	return result;
+}
+
+std::string join_languages(const std::vector<std::string> &languages)
+{
+	std::string result;
+	for (const auto &language : languages) {
+		result += (result.empty() ? "" : ",") + language;
+	}
+	return result;
+}
+
+// with config_mutex held
+obs_data_t *plugin_config_data()
+{
+	obs_data_t *data = obs_data_create();
+	obs_data_set_int(data, "memory_budget_mb", (long long)config.memory_budget_mb);
+	obs_data_set_bool(data, "share_models", config.share_models);
+	obs_data_set_string(data, "preload_languages", join_languages(preload_languages).c_str());
+	obs_data_set_string(data, "recent_languages", join_languages(recent_languages).c_str());
+	return data;
+}
+
+// Write and release the data, without config_mutex held
+void write_plugin_config(obs_data_t *data)
+{
+	check_plugin_config_folder_exists();
+	char *config_path = obs_module_config_path("config.json");
+	if (!obs_data_save_json_pretty_safe(data, config_path, "tmp", "bak")) {
+		obs_log(LOG_WARNING, "Failed to save plugin config to %s", config_path);
+	}
+	obs_data_release(data);
+	bfree(config_path);
+}
+
+void save_loop()
+{
+	std::unique_lock<std::mutex> lock(config_mutex);
+	while (true) {
+		save_cv.wait(lock, [] { return save_pending || save_stop; });
+		if (save_pending) {
+			save_pending = false;
+			obs_data_t *data = plugin_config_data();
+			// the changes made meanwhile are saved on the next round
+			lock.unlock();
+			write_plugin_config(data);
+			lock.lock();
+		} else {
+			return;
+		}
+	}
+}
+
+// with config_mutex held
+void request_save()
+{
+	if (save_stop) {
+		return;
+	}
+	save_pending = true;
+	if (!save_thread.joinable()) {
+		save_thread = std::thread(save_loop);
+	}
+	save_cv.notify_one();
+}
+
+} // namespace
+
+void plugin_config_load(void)
+{
+	std::lock_guard<std::mutex> lock(config_mutex);
+	check_plugin_config_folder_exists();
+	char *config_path = obs_module_config_path("config.json");
+
+	obs_data_t *data = obs_data_create_from_json_file(config_path);
+	const bool exists = data != nullptr;
+	if (!exists) {
+		data = obs_data_create();
+	}
+	plugin_config_defaults(data);
+	save_stop = false;
+
+	config.memory_budget_mb = (uint64_t)obs_data_get_int(data, "memory_budget_mb");
+	config.share_models = obs_data_get_bool(data, "share_models");
+	preload_languages = split_languages(obs_data_get_string(data, "preload_languages"));
+	recent_languages = split_languages(obs_data_get_string(data, "recent_languages"));
+	ocr_memory_set_budget(config.memory_budget_mb * 1024 * 1024);
+	obs_data_release(data);
+
+	if (!exists) {
+		// write the defaults so the file can be found and edited
+		request_save();
+	}
+
+	obs_log(LOG_INFO, "Plugin config %s: memory budget %llu MB, share models %s", config_path,
+		(unsigned long long)config.memory_budget_mb, config.share_models ? "on" : "off");
+	bfree(config_path);
+}
+
+const plugin_config *get_plugin_config(void)
+{
+	return &config;
+}
+
+void plugin_config_record_language(const char *language)
+{
+	if (language == nullptr || *language == '\0') {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(config_mutex);
+	if (!recent_languages.empty() && recent_languages.front() == language) {
+		return;
+	}
+	recent_languages.erase(
+		std::remove(recent_languages.begin(), recent_languages.end(), language),
+		recent_languages.end());
+	recent_languages.insert(recent_languages.begin(), language);
+	if (recent_languages.size() > MAX_RECENT_LANGUAGES) {
+		recent_languages.resize(MAX_RECENT_LANGUAGES);
+	}
+	request_save();
+}
+
+void plugin_config_stop(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(config_mutex);
+		save_stop = true;
+		save_cv.notify_one();
+	}
+	// the thread writes the pending changes before it stops
+	if (save_thread.joinable()) {
+		save_thread.join();
+	}
+}
+
+std::vector<std::string> get_plugin_config_preload_languages()
+{
+	std::lock_guard<std::mutex> lock(config_mutex);
+	std::vector<std::string> languages = preload_languages;
+	for (const auto &language : recent_languages) {
+		if (std::find(languages.begin(), languages.end(), language) == languages.end()) {
+			languages.push_back(language);
+		}
+	}
+	return languages;
+}
@@ -0,0 +1,41 @@
+#ifndef PLUGIN_CONFIG_H
+#define PLUGIN_CONFIG_H
+
+// Plugin-wide settings, read from config.json in the plugin config folder. Unlike the filter
+// settings they apply to all OCR filters at once.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct plugin_config {
+	// memory all OCR filters and models may use together, 0 for unlimited
+	uint64_t memory_budget_mb;
+	// let filters with the same language share one model even below the budget
+	bool share_models;
+};
+
+void plugin_config_load(void);
+const struct plugin_config *get_plugin_config(void);
+
+// Remember a language loaded by a filter, so it is preloaded the next time OBS starts. The
+// config file is written in the background.
+void plugin_config_record_language(const char *language);
+// Write the pending changes to the config file and stop writing in the background
+void plugin_config_stop(void);
+
+#ifdef __cplusplus
+}
+
+#include <string>
+#include <vector>
+
+// The languages to load when the plugin loads: the configured preload_languages followed by
+// the languages filters used recently
+std::vector<std::string> get_plugin_config_preload_languages();
+#endif
+
+#endif /* PLUGIN_CONFIG_H */
@@ -19,6 +19,10 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #include <obs-module.h>
 #include <plugin-support.h>
 
+#include "plugin-config.h"
+#include "model-preload.h"
+#include "frame-arena.h"
+
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE(PLUGIN_NAME, "en-US")
 
@@ -31,6 +35,8 @@ MODULE_EXPORT const char *obs_module_description(void)
 
 bool obs_module_load(void)
 {
+	plugin_config_load();
+	model_preload_start();
 	obs_register_source(&ocr_filter_info);
 	obs_log(LOG_INFO, "OCR plugin loaded successfully (version %s)", PLUGIN_VERSION);
 	return true;
@@ -38,5 +44,9 @@ bool obs_module_load(void)
 
 void obs_module_unload(void)
 {
+	model_preload_stop();
+	plugin_config_stop();
+	// OpenCV may stay loaded in the process after the plugin
+	frame_arena_restore_default_allocator();
 	obs_log(LOG_INFO, "OCR plugin unloaded");
 }
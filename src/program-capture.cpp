@@ -0,0 +1,82 @@
+#include "program-capture.h"
+#include "obs-utils.h"
+#include "tesseract-ocr-utils.h"
+#include "plugin-support.h"
+#include "ocr-trace.h"
+
+#include <obs-module.h>
+
+#include <algorithm>
+
+namespace {
+
+void program_frame_callback(void *param, struct video_data *frame)
+{
+	filter_data *tf = reinterpret_cast<filter_data *>(param);
+	if (!obs_source_enabled(tf->source)) {
+		return;
+	}
+	OCR_TRACE_SPAN("program_frame_tap");
+	// NV12 in full range: the Y plane is the grayscale frame
+	storeInputFrame(tf,
+			cv::Mat((int)tf->programCaptureHeight, (int)tf->programCaptureWidth,
+				CV_8UC1, frame->data[0], frame->linesize[0]),
+			frame->timestamp, false);
+}
+
+} // namespace
+
+void update_program_capture(filter_data *tf, bool enabled, uint32_t scale_percent)
+{
+	struct obs_video_info ovi;
+	if (enabled && !obs_get_video_info(&ovi)) {
+		obs_log(LOG_ERROR, "No video output, cannot read the program output");
+		enabled = false;
+	}
+	if (!enabled) {
+		stop_program_capture(tf);
+		return;
+	}
+
+	// NV12 needs even sizes
+	const uint32_t width = std::max(2u, (ovi.output_width * scale_percent / 100) & ~1u);
+	const uint32_t height = std::max(2u, (ovi.output_height * scale_percent / 100) & ~1u);
+	// frames faster than OCR runs would only be dropped
+	const double fps = (double)ovi.fps_num / (double)ovi.fps_den;
+	const uint32_t divisor = std::max(1u, (uint32_t)(fps * tf->update_timer_ms / 1000.0));
+	if (tf->programCapture && width == tf->programCaptureWidth &&
+	    height == tf->programCaptureHeight && divisor == tf->programCaptureDivisor) {
+		return;
+	}
+	stop_program_capture(tf);
+
+	tf->programCaptureWidth = width;
+	tf->programCaptureHeight = height;
+	tf->programCaptureDivisor = divisor;
+	struct video_scale_info conversion = {};
+	conversion.format = VIDEO_FORMAT_NV12;
+	conversion.width = width;
+	conversion.height = height;
+	conversion.range = VIDEO_RANGE_FULL;
+	conversion.colorspace = ovi.colorspace;
+	obs_add_raw_video_callback2(&conversion, divisor, program_frame_callback, tf);
+	tf->programCapture = true;
+	obs_log(LOG_INFO, "[%s] reading the program output at %ux%u, every %u frames",
+		obs_source_get_name(tf->source), width, height, divisor);
+
+	// the program is always shown, whether or not the filter's source is
+	tf->isDisabled = false;
+	wake_tesseract_thread(tf);
+}
+
+void stop_program_capture(filter_data *tf)
+{
+	if (!tf->programCapture) {
+		return;
+	}
+	// once removed, the video thread does not call back anymore
+	obs_remove_raw_video_callback(program_frame_callback, tf);
+	tf->programCapture = false;
+	tf->isDisabled = !obs_source_active(tf->source);
+	wake_tesseract_thread(tf);
+}
@@ -0,0 +1,19 @@
+#ifndef PROGRAM_CAPTURE_H
+#define PROGRAM_CAPTURE_H
+
+// OCR of the program output instead of the filter's source. Frames come from the raw video
+// output OBS already converts for encoding, so no source is rendered or read back for OCR.
+
+#include "filter-data.h"
+
+/**
+  * @brief Start, stop or reconfigure reading the program output for the filter.
+  *
+  * @param tf  The filter data
+  * @param enabled  Read the program output instead of the source
+  * @param scale_percent  Size of the frames given to OCR, in percent of the output size
+*/
+void update_program_capture(filter_data *tf, bool enabled, uint32_t scale_percent);
+void stop_program_capture(filter_data *tf);
+
+#endif /* PROGRAM_CAPTURE_H */
@@ -0,0 +1,162 @@
+#include "redaction.h"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+namespace {
+
+// the longest run of words a pattern or keyword is matched against
+const size_t MAX_RUN_WORDS = 6;
+
+// ASCII only, other UTF-8 bytes are left as they are
+std::string lowercase(const std::string &text)
+{
+	std::string lowered = text;
+	std::transform(lowered.begin(), lowered.end(), lowered.begin(),
+		       [](unsigned char c) { return (char)std::tolower(c); });
+	return lowered;
+}
+
+// words are boxes of one line when they overlap vertically by half the smaller height and
+// follow each other from left to right
+bool same_line(const cv::Rect &previous, const cv::Rect &next)
+{
+	const int overlap = std::min(previous.br().y, next.br().y) - std::max(previous.y, next.y);
+	return next.x >= previous.x && overlap * 2 >= std::min(previous.height, next.height);
+}
+
+} // namespace
+
+text_redactor::text_redactor(const std::string &pattern_, const std::string &keywords_)
+{
+	if (!pattern_.empty()) {
+		pattern = std::regex(pattern_, std::regex::ECMAScript | std::regex::icase);
+		has_pattern = true;
+	}
+	std::stringstream stream(keywords_);
+	std::string keyword;
+	while (std::getline(stream, keyword, ',')) {
+		// the same spacing as the runs of words
+		std::stringstream words(lowercase(keyword));
+		std::string word;
+		std::string normalized;
+		while (words >> word) {
+			normalized += normalized.empty() ? word : " " + word;
+		}
+		if (!normalized.empty()) {
+			keywords.push_back(normalized);
+		}
+	}
+}
+
+bool text_redactor::matches(const std::string &lowered) const
+{
+	if (lowered.empty()) {
+		return false;
+	}
+	if (has_pattern && std::regex_search(lowered, pattern)) {
+		return true;
+	}
+	return std::any_of(keywords.begin(), keywords.end(), [&](const std::string &keyword) {
+		return lowered.find(keyword) != std::string::npos;
+	});
+}
+
+std::vector<cv::Rect> text_redactor::match(const std::vector<OCRBox> &boxes) const
+{
+	std::vector<cv::Rect> matched;
+	if (empty()) {
+		return matched;
+	}
+	std::vector<std::string> words;
+	words.reserve(boxes.size());
+	for (const auto &box : boxes) {
+		words.push_back(lowercase(box.text));
+	}
+
+	std::vector<bool> redact(boxes.size(), false);
+	for (size_t first = 0; first < boxes.size(); first++) {
+		if (matches(words[first])) {
+			redact[first] = true;
+		}
+		// runs of two or more words, redacted only if neither end word can be left out, so
+		// a match does not spread to the words around it
+		std::string run = words[first];
+		std::string without_first;
+		for (size_t last = first + 1;
+		     last < boxes.size() && last - first < MAX_RUN_WORDS &&
+		     same_line(boxes[last - 1].box, boxes[last].box);
+		     last++) {
+			const std::string without_last = run;
+			run += " " + words[last];
+			without_first += without_first.empty() ? words[last] : " " + words[last];
+			if (matches(run) && !matches(without_first) && !matches(without_last)) {
+				for (size_t i = first; i <= last; i++) {
+					redact[i] = true;
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < boxes.size(); i++) {
+		if (redact[i]) {
+			matched.push_back(boxes[i].box);
+		}
+	}
+	return matched;
+}
+
+void redaction_hold::update(const std::vector<cv::Rect> &boxes, int padding, cv::Size source_size,
+			    uint64_t now_ns, uint64_t hold_ns)
+{
+	const cv::Rect frame(cv::Point(0, 0), source_size);
+	std::vector<held_box> detected;
+	detected.reserve(boxes.size());
+	for (const auto &box : boxes) {
+		const cv::Rect padded = cv::Rect(box.x - padding, box.y - padding,
+						 box.width + 2 * padding,
+						 box.height + 2 * padding) &
+					frame;
+		if (!padded.empty()) {
+			detected.push_back({padded, now_ns + hold_ns, true});
+		}
+	}
+	// the previous boxes are held where they were last seen, unless a new box covers them
+	const auto new_end = (long)detected.size();
+	for (auto &previous : held) {
+		const bool replaced = std::any_of(
+			detected.begin(), detected.begin() + new_end, [&](const held_box &box) {
+				return (box.box & previous.box).area() * 2 >= previous.box.area();
+			});
+		if (!replaced) {
+			previous.current = false;
+			detected.push_back(previous);
+		}
+	}
+	held.swap(detected);
+}
+
+void redaction_hold::refresh(uint64_t now_ns, uint64_t hold_ns)
+{
+	for (auto &box : held) {
+		if (box.current) {
+			box.expires_ns = std::max(box.expires_ns, now_ns + hold_ns);
+		}
+	}
+}
+
+std::vector<cv::Rect> redaction_hold::active(uint64_t now_ns)
+{
+	held.erase(std::remove_if(held.begin(), held.end(),
+				  [now_ns](const held_box &box) {
+					  return box.expires_ns <= now_ns;
+				  }),
+		   held.end());
+	std::vector<cv::Rect> boxes;
+	boxes.reserve(held.size());
+	for (const auto &box : held) {
+		boxes.push_back(box.box);
+	}
+	return boxes;
+}
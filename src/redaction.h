@@ -0,0 +1,88 @@
+#ifndef REDACTION_H
+#define REDACTION_H
+
+// Which text boxes to redact and for how long. The OCR thread finds the boxes whose text
+// matches, the render thread hides them on every frame until their hold time runs out. Free
+// of OBS types.
+
+#include "ocr-pipeline.h"
+
+#include <opencv2/core/types.hpp>
+
+#include <cstdint>
+#include <regex>
+#include <string>
+#include <vector>
+
+enum redaction_mode {
+	REDACTION_MODE_OFF = 0,
+	REDACTION_MODE_PIXELATE,
+	REDACTION_MODE_BLUR,
+};
+
+/**
+  * @brief Matches the text of word boxes against a pattern and a list of keywords.
+  *
+  * A word matches if the pattern is found in it or it contains a keyword, case-insensitive.
+  * Runs of a few words on the same line are matched too, so a pattern or keyword with spaces
+  * (e.g. a phone number or a full name) redacts all its words.
+*/
+class text_redactor {
+public:
+	text_redactor() = default;
+	/**
+	  * @param pattern  An ECMAScript regular expression, empty for none
+	  * @param keywords  Comma separated keywords, empty for none
+	  * @throws std::regex_error if the pattern is not valid
+	*/
+	text_redactor(const std::string &pattern, const std::string &keywords);
+
+	bool empty() const { return !has_pattern && keywords.empty(); }
+	// The boxes to redact, a subset of boxes
+	std::vector<cv::Rect> match(const std::vector<OCRBox> &boxes) const;
+
+private:
+	bool matches(const std::string &lowered) const;
+
+	bool has_pattern = false;
+	std::regex pattern;
+	// lowercase, with single spaces between words
+	std::vector<std::string> keywords;
+};
+
+/**
+  * @brief The boxes being redacted, each until its hold time runs out.
+  *
+  * Boxes of the latest detection are current. When a new detection replaces them they are
+  * held at their last position until they expire, so redaction never drops out between
+  * detections or while OCR catches up with text that moved.
+*/
+class redaction_hold {
+public:
+	/**
+	  * @brief Replace the current boxes with a new detection.
+	  *
+	  * @param boxes  The boxes to redact, in source pixels
+	  * @param padding  Pixels added around each box
+	  * @param source_size  The boxes are clipped to it
+	  * @param now_ns  The time of the detection
+	  * @param hold_ns  How long the boxes stay redacted without being detected again
+	*/
+	void update(const std::vector<cv::Rect> &boxes, int padding, cv::Size source_size,
+		    uint64_t now_ns, uint64_t hold_ns);
+	// The current boxes were seen again where they are, e.g. in an unchanged frame
+	void refresh(uint64_t now_ns, uint64_t hold_ns);
+	void clear() { held.clear(); }
+	// The boxes to redact at now_ns, expired boxes are dropped
+	std::vector<cv::Rect> active(uint64_t now_ns);
+
+private:
+	struct held_box {
+		cv::Rect box;
+		uint64_t expires_ns;
+		bool current;
+	};
+	std::vector<held_box> held;
+};
+
+#endif /* REDACTION_H */
@@ -0,0 +1,107 @@
+#include "roi-atlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <sstream>
+
+namespace {
+
+std::vector<cv::Rect> clip_regions(const std::vector<cv::Rect> &regions, cv::Size source_size)
+{
+	std::vector<cv::Rect> clipped;
+	const cv::Rect source(cv::Point(0, 0), source_size);
+	for (const auto &region : regions) {
+		const cv::Rect inside = region & source;
+		if (!inside.empty()) {
+			clipped.push_back(inside);
+		}
+	}
+	return clipped;
+}
+
+} // namespace
+
+std::vector<cv::Rect> parse_regions(const std::string &text)
+{
+	std::vector<cv::Rect> regions;
+	std::stringstream stream(text);
+	std::string region;
+	while (std::getline(stream, region, ';')) {
+		std::replace(region.begin(), region.end(), ',', ' ');
+		std::stringstream values(region);
+		int x, y, width, height;
+		if (values >> x >> y >> width >> height && width > 0 && height > 0) {
+			regions.emplace_back(x, y, width, height);
+		}
+	}
+	return regions;
+}
+
+roi_atlas pack_roi_atlas(const std::vector<cv::Rect> &regions, cv::Size source_size)
+{
+	roi_atlas atlas;
+	atlas.regions = clip_regions(regions, source_size);
+	if (atlas.regions.empty()) {
+		return atlas;
+	}
+
+	int widest = 0;
+	double total_area = 0;
+	for (const auto &region : atlas.regions) {
+		widest = std::max(widest, region.width);
+		total_area += region.area();
+	}
+	const int shelf_width = std::max(widest, (int)std::ceil(std::sqrt(total_area)));
+
+	std::vector<size_t> order(atlas.regions.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&atlas](size_t a, size_t b) {
+		return atlas.regions[a].height > atlas.regions[b].height;
+	});
+
+	atlas.tiles.resize(atlas.regions.size());
+	int shelf_y = 0;
+	int shelf_height = 0;
+	int x = 0;
+	for (size_t index : order) {
+		const cv::Rect &region = atlas.regions[index];
+		if (x + region.width > shelf_width) {
+			// start a new shelf, as high as its first (highest) region
+			shelf_y += shelf_height;
+			shelf_height = 0;
+			x = 0;
+		}
+		atlas.tiles[index] = cv::Rect(x, shelf_y, region.width, region.height);
+		x += region.width;
+		shelf_height = std::max(shelf_height, region.height);
+		atlas.size.width = std::max(atlas.size.width, x);
+	}
+	atlas.size.height = shelf_y + shelf_height;
+	return atlas;
+}
+
+roi_atlas roi_views_in_frame(const std::vector<cv::Rect> &regions, cv::Size source_size,
+			     cv::Size frame_size)
+{
+	roi_atlas atlas;
+	atlas.size = frame_size;
+	if (source_size.empty()) {
+		return atlas;
+	}
+	const double scale_x = (double)frame_size.width / (double)source_size.width;
+	const double scale_y = (double)frame_size.height / (double)source_size.height;
+	const cv::Rect frame(cv::Point(0, 0), frame_size);
+	for (const auto &region : clip_regions(regions, source_size)) {
+		const cv::Rect tile = cv::Rect(cvRound(region.x * scale_x),
+					       cvRound(region.y * scale_y),
+					       cvRound(region.width * scale_x),
+					       cvRound(region.height * scale_y)) &
+				      frame;
+		if (!tile.empty()) {
+			atlas.regions.push_back(region);
+			atlas.tiles.push_back(tile);
+		}
+	}
+	return atlas;
+}
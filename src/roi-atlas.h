@@ -0,0 +1,42 @@
+#ifndef ROI_ATLAS_H
+#define ROI_ATLAS_H
+
+// Regions of interest of a filter and their packing into one atlas, so all regions are drawn
+// into a single texture and read back with one staging copy. Free of OBS types.
+
+#include <opencv2/core/mat.hpp>
+
+#include <string>
+#include <vector>
+
+/**
+  * @brief Where each region of the source lands in a frame given to OCR.
+  *
+  * regions are in source pixels, tiles in pixels of the frame, in the same order. The OCR
+  * thread recognizes each tile through a view into the frame, without copying it.
+*/
+struct roi_atlas {
+	std::vector<cv::Rect> regions;
+	std::vector<cv::Rect> tiles;
+	// size of the frame the tiles are in
+	cv::Size size;
+
+	bool empty() const { return tiles.empty(); }
+};
+
+// Parse "x,y,width,height; x,y,width,height", skipping malformed or empty regions
+std::vector<cv::Rect> parse_regions(const std::string &text);
+
+/**
+  * @brief Shelf-pack the regions, clipped to the source, into an atlas.
+  *
+  * Regions are placed by decreasing height on shelves no wider than the widest region or the
+  * square root of the total area, whichever is larger.
+*/
+roi_atlas pack_roi_atlas(const std::vector<cv::Rect> &regions, cv::Size source_size);
+
+// The regions as views into a frame of the whole source, scaled to the frame size
+roi_atlas roi_views_in_frame(const std::vector<cv::Rect> &regions, cv::Size source_size,
+			     cv::Size frame_size);
+
+#endif /* ROI_ATLAS_H */
@@ -0,0 +1,238 @@
+#include "scroll-tracker.h"
+
+#include <opencv2/core.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace {
+
+// mean profile difference, in gray levels, below which two frames show the same content
+const float MATCH_ERROR = 3.0f;
+// tokens of the stream kept to find the overlap with the next strip
+const size_t TAIL_TOKENS = 64;
+
+// OCR of the same text differs slightly between reads, e.g. "He1lo" and "Hello"
+bool similar(const std::string &a, const std::string &b)
+{
+	if (a == b) {
+		return true;
+	}
+	const size_t allowed = std::max(a.size(), b.size()) / 5;
+	if (allowed == 0 || (size_t)std::abs((int)a.size() - (int)b.size()) > allowed) {
+		return false;
+	}
+	// Levenshtein distance, one row at a time
+	std::vector<size_t> row(b.size() + 1);
+	for (size_t j = 0; j <= b.size(); j++) {
+		row[j] = j;
+	}
+	for (size_t i = 1; i <= a.size(); i++) {
+		size_t diagonal = row[0];
+		row[0] = i;
+		for (size_t j = 1; j <= b.size(); j++) {
+			const size_t above = row[j];
+			row[j] = std::min({row[j] + 1, row[j - 1] + 1,
+					   diagonal + (a[i - 1] == b[j - 1] ? 0 : 1)});
+			diagonal = above;
+		}
+	}
+	return row[b.size()] <= allowed;
+}
+
+} // namespace
+
+std::vector<float> scroll_profile(const cv::Mat &gray, scroll_mode mode)
+{
+	cv::Mat profile;
+	// a column of row means, or a row of column means
+	cv::reduce(gray, profile, mode == SCROLL_MODE_HORIZONTAL ? 0 : 1, cv::REDUCE_AVG, CV_32F);
+	return std::vector<float>(profile.begin<float>(), profile.end<float>());
+}
+
+scroll_estimate estimate_scroll(const std::vector<float> &previous,
+				const std::vector<float> &current)
+{
+	scroll_estimate best;
+	if (previous.size() != current.size() || current.empty()) {
+		return best;
+	}
+	const int length = (int)current.size();
+	best.error = INFINITY;
+	// 0, 1, -1, 2, -2, ... so ties keep the smallest offset
+	for (int step = 0; step <= length; step++) {
+		const int offset = step % 2 == 0 ? step / 2 : -(step + 1) / 2;
+		if (std::abs(offset) > length / 2) {
+			break;
+		}
+		// content moved by offset: current[i] shows what previous[i + offset] showed
+		const int begin = std::max(0, -offset);
+		const int end = std::min(length, length - offset);
+		float error = 0.0f;
+		for (int i = begin; i < end; i++) {
+			error += std::abs(current[i] - previous[i + offset]);
+		}
+		error /= (float)(end - begin);
+		if (error < best.error) {
+			best.error = error;
+			best.offset = offset;
+		}
+	}
+	best.matched = best.error <= MATCH_ERROR;
+	return best;
+}
+
+std::vector<std::string> scroll_text_stitcher::split(const std::string &text) const
+{
+	std::vector<std::string> tokens;
+	std::stringstream stream(text);
+	std::string token;
+	if (mode == SCROLL_MODE_HORIZONTAL) {
+		while (stream >> token) {
+			tokens.push_back(token);
+		}
+		return tokens;
+	}
+	while (std::getline(stream, token)) {
+		// the same line may be read with different spacing
+		std::stringstream words(token);
+		std::string word;
+		std::string line;
+		while (words >> word) {
+			line += line.empty() ? word : " " + word;
+		}
+		if (!line.empty()) {
+			tokens.push_back(line);
+		}
+	}
+	return tokens;
+}
+
+std::string scroll_text_stitcher::join(const std::vector<std::string> &tokens) const
+{
+	std::string joined;
+	for (const auto &token : tokens) {
+		if (!joined.empty()) {
+			joined += mode == SCROLL_MODE_HORIZONTAL ? " " : "\n";
+		}
+		joined += token;
+	}
+	return joined;
+}
+
+std::string scroll_text_stitcher::add(const std::string &text)
+{
+	const std::vector<std::string> tokens = split(text);
+	if (tokens.empty()) {
+		return "";
+	}
+	std::vector<std::string> seen = tail;
+	if (!pending.empty()) {
+		seen.push_back(pending);
+	}
+
+	// the longest run at the end of the stream that the strip starts with, possibly after a
+	// token cut by the trailing edge of the strip
+	size_t overlap_end = 0;
+	for (size_t length = std::min(seen.size(), tokens.size()); length > 0 && overlap_end == 0;
+	     length--) {
+		for (size_t skip = 0; skip <= 1 && skip + length <= tokens.size(); skip++) {
+			if (skip == 1 && length == 1) {
+				// one token after a skipped one is too likely a coincidence
+				break;
+			}
+			bool match = true;
+			for (size_t i = 0; i < length && match; i++) {
+				const std::string &before = seen[seen.size() - length + i];
+				const std::string &now = tokens[skip + i];
+				// the held back token may have been cut, it is complete now
+				const bool last_pending = !pending.empty() && i == length - 1;
+				const bool completed =
+					last_pending && now.compare(0, before.size(), before) == 0;
+				match = similar(before, now) || completed;
+			}
+			if (match) {
+				overlap_end = skip + length;
+				break;
+			}
+		}
+	}
+
+	std::vector<std::string> fresh;
+	if (overlap_end > 0 && !pending.empty()) {
+		// the held back token, as read in this strip
+		fresh.push_back(tokens[overlap_end - 1]);
+	} else if (!pending.empty()) {
+		fresh.push_back(pending);
+	}
+	fresh.insert(fresh.end(), tokens.begin() + (long)overlap_end, tokens.end());
+	pending.clear();
+	if (overlap_end < tokens.size()) {
+		// the strip brought new tokens, the last one touches the edge of the frame
+		pending = fresh.back();
+		fresh.pop_back();
+	}
+
+	tail.insert(tail.end(), fresh.begin(), fresh.end());
+	if (tail.size() > TAIL_TOKENS) {
+		tail.erase(tail.begin(), tail.end() - (long)TAIL_TOKENS);
+	}
+	return join(fresh);
+}
+
+std::string scroll_text_stitcher::flush()
+{
+	if (pending.empty()) {
+		return "";
+	}
+	tail.push_back(pending);
+	std::string flushed;
+	flushed.swap(pending);
+	return flushed;
+}
+
+void scroll_tracker::reset(scroll_mode mode)
+{
+	current_mode = mode;
+	reference.clear();
+	candidate.clear();
+	stitcher = scroll_text_stitcher(mode);
+	stopped = false;
+}
+
+cv::Rect scroll_tracker::plan(const cv::Mat &gray)
+{
+	const cv::Rect whole(cv::Point(0, 0), gray.size());
+	candidate = scroll_profile(gray, current_mode);
+	const int length = (int)candidate.size();
+	const scroll_estimate estimate = estimate_scroll(reference, candidate);
+	stopped = false;
+	if (!estimate.matched || estimate.offset < 0) {
+		// new content, or scrolled back: read it all, the stitcher drops what was read
+		return whole;
+	}
+	// wait for a few pixels of new content, a thinner strip holds no readable text
+	if (estimate.offset < std::max(1, length / 16)) {
+		stopped = estimate.offset == 0;
+		return cv::Rect();
+	}
+	// widen the strip by a quarter of the frame, so the token held back at the edge last
+	// time is read again in full
+	const int start = std::max(0, length - estimate.offset - length / 4);
+	if (current_mode == SCROLL_MODE_HORIZONTAL) {
+		return cv::Rect(start, 0, length - start, gray.rows);
+	}
+	return cv::Rect(0, start, gray.cols, length - start);
+}
+
+std::string scroll_tracker::commit(const std::string &text)
+{
+	reference.swap(candidate);
+	return stitcher.add(text);
+}
+
+std::string scroll_tracker::idle()
+{
+	return stopped ? stitcher.flush() : "";
+}
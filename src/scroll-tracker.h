@@ -0,0 +1,106 @@
+#ifndef SCROLL_TRACKER_H
+#define SCROLL_TRACKER_H
+
+// Incremental OCR of scrolling text (tickers, chat boxes): the scroll offset between frames is
+// estimated from their row or column profiles, only the newly revealed strip is recognized,
+// and its text is stitched onto what was already read. Free of OBS types.
+
+#include <opencv2/core/mat.hpp>
+
+#include <string>
+#include <vector>
+
+enum scroll_mode {
+	SCROLL_MODE_OFF = 0,
+	// content moves up, new lines appear at the bottom, e.g. a chat box
+	SCROLL_MODE_VERTICAL,
+	// content moves left, new words appear on the right, e.g. a news ticker
+	SCROLL_MODE_HORIZONTAL,
+};
+
+/**
+  * @brief The mean of each row (vertical) or column (horizontal) of a grayscale image.
+  *
+  * Scrolling shifts the profile by the scroll offset, so matching two profiles finds the
+  * offset without comparing whole images.
+*/
+std::vector<float> scroll_profile(const cv::Mat &gray, scroll_mode mode);
+
+struct scroll_estimate {
+	// pixels the content moved towards the top or left, negative if it moved back
+	int offset = 0;
+	// mean absolute difference of the profiles where they overlap at the offset
+	float error = 0.0f;
+	// the profiles overlap well enough at the offset to be the same content
+	bool matched = false;
+};
+
+/**
+  * @brief Find the offset that best aligns current with previous, up to half their length.
+  *
+  * Ties go to the smallest offset, so blank or uniform content does not appear to scroll.
+*/
+scroll_estimate estimate_scroll(const std::vector<float> &previous,
+				const std::vector<float> &current);
+
+/**
+  * @brief Joins the text of overlapping strips into one stream, returning only new text.
+  *
+  * Tokens are lines for vertical scrolling and words for horizontal scrolling. The first
+  * tokens of a strip that repeat the end of the stream are dropped. The last token of a strip
+  * may be cut by the edge of the frame, so it is held back until the next strip confirms or
+  * completes it, or until the scrolling stops.
+*/
+class scroll_text_stitcher {
+public:
+	explicit scroll_text_stitcher(scroll_mode mode_ = SCROLL_MODE_VERTICAL) : mode(mode_) {}
+
+	// The text of the strip that was not read before, empty if none
+	std::string add(const std::string &text);
+	// The held back token, now final
+	std::string flush();
+
+private:
+	std::vector<std::string> split(const std::string &text) const;
+	std::string join(const std::vector<std::string> &tokens) const;
+
+	scroll_mode mode;
+	// the end of the stream, enough to find the overlap with the next strip
+	std::vector<std::string> tail;
+	std::string pending;
+};
+
+/**
+  * @brief Decides which part of each frame to recognize in scroll mode.
+  *
+  * Offsets are measured against the last recognized frame, so slow scrolling accumulates until
+  * enough new content is revealed.
+*/
+class scroll_tracker {
+public:
+	scroll_mode mode() const { return current_mode; }
+	// Forget the previous frames, e.g. when the mode or the source size changes
+	void reset(scroll_mode mode);
+
+	/**
+	  * @brief The part of the frame to recognize.
+	  *
+	  * The strip revealed since the last recognized frame, widened by an overlap so text cut
+	  * at its edge is read whole, or the whole frame if the frame does not match the last
+	  * one. Empty if the content did not move enough to reveal new text.
+	*/
+	cv::Rect plan(const cv::Mat &gray);
+	// The text recognized in the planned part, returns the text that is new to the stream
+	std::string commit(const std::string &text);
+	// Called when plan found nothing new: the held back text, once the scrolling stops
+	std::string idle();
+
+private:
+	scroll_mode current_mode = SCROLL_MODE_OFF;
+	std::vector<float> reference;
+	std::vector<float> candidate;
+	scroll_text_stitcher stitcher;
+	bool stopped = false;
+};
+
+#endif /* SCROLL_TRACKER_H */
@@ -0,0 +1,879 @@
+#include "simd-kernels.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define OCR_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define OCR_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC and Clang compile a function for an instruction set without building the whole file
+// for it, MSVC allows the intrinsics anywhere
+#if defined(OCR_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define OCR_TARGET(isa) __attribute__((target(isa)))
+#else
+#define OCR_TARGET(isa)
+#endif
+
+namespace {
+
+// BGR to gray weights of cv::cvtColor for 8-bit images, in 1/16384
+const int B2Y = 1868;
+const int G2Y = 9617;
+const int R2Y = 4899;
+constexpr int GRAY_SHIFT = 14;
+const int GRAY_ROUND = 1 << (GRAY_SHIFT - 1);
+
+typedef void (*gray_row_fn)(const uint8_t *bgra, uint8_t *gray, int count);
+
+void gray_row_scalar(const uint8_t *bgra, uint8_t *gray, int count)
+{
+	for (int i = 0; i < count; i++, bgra += 4) {
+		gray[i] = (uint8_t)((bgra[0] * B2Y + bgra[1] * G2Y + bgra[2] * R2Y + GRAY_ROUND) >>
+				    GRAY_SHIFT);
+	}
+}
+
+// 255 where src is above the threshold, 0 elsewhere
+typedef void (*threshold_row_fn)(const uint8_t *src, uint8_t *dst, int count, uint8_t threshold);
+// per byte absolute difference
+typedef void (*absdiff_row_fn)(const uint8_t *a, const uint8_t *b, uint8_t *dst, int count);
+typedef uint64_t (*count_nonzero_row_fn)(const uint8_t *src, int count);
+// the maximum of each byte and its neighbors channels bytes away in three rows, for the
+// bytes with both neighbors in the row
+typedef void (*max3x3_row_fn)(const uint8_t *above, const uint8_t *row, const uint8_t *below,
+			      uint8_t *dst, int count, int channels);
+// pixels to bits, returns false on a pixel that is neither 0 nor 255
+typedef bool (*pack_row_fn)(const uint8_t *src, uint8_t *bits, int count);
+
+void threshold_row_scalar(const uint8_t *src, uint8_t *dst, int count, uint8_t threshold)
+{
+	for (int i = 0; i < count; i++) {
+		dst[i] = (uint8_t)(-(int)(src[i] > threshold));
+	}
+}
+
+void absdiff_row_scalar(const uint8_t *a, const uint8_t *b, uint8_t *dst, int count)
+{
+	for (int i = 0; i < count; i++) {
+		dst[i] = (uint8_t)std::abs(a[i] - b[i]);
+	}
+}
+
+uint64_t count_nonzero_row_scalar(const uint8_t *src, int count)
+{
+	uint64_t nonzero = 0;
+	for (int i = 0; i < count; i++) {
+		nonzero += src[i] != 0;
+	}
+	return nonzero;
+}
+
+void max3x3_row_scalar(const uint8_t *above, const uint8_t *row, const uint8_t *below,
+		       uint8_t *dst, int count, int channels)
+{
+	for (int i = channels; i < count - channels; i++) {
+		uint8_t value = 0;
+		for (const uint8_t *line : {above, row, below}) {
+			value = std::max({value, line[i - channels], line[i], line[i + channels]});
+		}
+		dst[i] = value;
+	}
+}
+
+// bits of a byte in reverse order, pixels come least significant first out of movemask
+const uint8_t *reversed_bits()
+{
+	static const struct table {
+		uint8_t values[256];
+		table()
+		{
+			for (int i = 0; i < 256; i++) {
+				uint8_t reversed = 0;
+				for (int bit = 0; bit < 8; bit++) {
+					reversed |= (uint8_t)(((i >> bit) & 1) << (7 - bit));
+				}
+				values[i] = reversed;
+			}
+		}
+	} reversed;
+	return reversed.values;
+}
+
+bool pack_row_scalar(const uint8_t *src, uint8_t *bits, int count)
+{
+	for (int i = 0; i < count; i += 8) {
+		uint8_t byte = 0;
+		for (int bit = 0; bit < 8 && i + bit < count; bit++) {
+			const uint8_t value = src[i + bit];
+			if (value != 0 && value != 255) {
+				return false;
+			}
+			byte |= (uint8_t)((value >> 7) << (7 - bit));
+		}
+		bits[i / 8] = byte;
+	}
+	return true;
+}
+
+#if defined(OCR_SIMD_X86)
+
+struct x86_features {
+	bool sse41 = false;
+	bool avx2 = false;
+};
+
+const x86_features &detect_x86_features()
+{
+	static const x86_features features = [] {
+		x86_features detected;
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		const int max_leaf = info[0];
+		__cpuid(info, 1);
+		detected.sse41 = (info[2] & (1 << 19)) != 0;
+		// AVX registers also need to be saved by the OS
+		const bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+				 (_xgetbv(0) & 6) == 6;
+		if (max_leaf >= 7 && avx) {
+			__cpuidex(info, 7, 0);
+			detected.avx2 = (info[1] & (1 << 5)) != 0;
+		}
+#else
+		__builtin_cpu_init();
+		detected.sse41 = __builtin_cpu_supports("sse4.1");
+		detected.avx2 = __builtin_cpu_supports("avx2");
+#endif
+		return detected;
+	}();
+	return features;
+}
+
+// 4 pixels to their weighted sums: two pixels per 16-bit vector, multiplied and added in
+// pairs to B*B2Y + G*G2Y and R*R2Y, then the pairs added
+OCR_TARGET("sse4.1") inline __m128i gray_sums_sse41(__m128i pixels, __m128i coeffs)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), coeffs);
+	const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), coeffs);
+	return _mm_srli_epi32(_mm_add_epi32(_mm_hadd_epi32(lo, hi), _mm_set1_epi32(GRAY_ROUND)),
+			      GRAY_SHIFT);
+}
+
+OCR_TARGET("sse4.1") void gray_row_sse41(const uint8_t *bgra, uint8_t *gray, int count)
+{
+	const __m128i coeffs = _mm_setr_epi16(B2Y, G2Y, R2Y, 0, B2Y, G2Y, R2Y, 0);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m128i p0 = _mm_loadu_si128((const __m128i *)(bgra + i * 4));
+		const __m128i p1 = _mm_loadu_si128((const __m128i *)(bgra + i * 4 + 16));
+		const __m128i words = _mm_packus_epi32(gray_sums_sse41(p0, coeffs),
+						       gray_sums_sse41(p1, coeffs));
+		_mm_storel_epi64((__m128i *)(gray + i), _mm_packus_epi16(words, words));
+	}
+	gray_row_scalar(bgra + i * 4, gray + i, count - i);
+}
+
+// as gray_sums_sse41, pixels 0-3 in the low lane and 4-7 in the high lane
+OCR_TARGET("avx2") inline __m256i gray_sums_avx2(__m256i pixels, __m256i coeffs)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(pixels, zero), coeffs);
+	const __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(pixels, zero), coeffs);
+	return _mm256_srli_epi32(
+		_mm256_add_epi32(_mm256_hadd_epi32(lo, hi), _mm256_set1_epi32(GRAY_ROUND)),
+		GRAY_SHIFT);
+}
+
+OCR_TARGET("avx2") void gray_row_avx2(const uint8_t *bgra, uint8_t *gray, int count)
+{
+	const __m256i coeffs = _mm256_setr_epi16(B2Y, G2Y, R2Y, 0, B2Y, G2Y, R2Y, 0, B2Y, G2Y,
+						 R2Y, 0, B2Y, G2Y, R2Y, 0);
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		const __m256i p0 = _mm256_loadu_si256((const __m256i *)(bgra + i * 4));
+		const __m256i p1 = _mm256_loadu_si256((const __m256i *)(bgra + i * 4 + 32));
+		// packing works per lane: pixels 0-3, 8-11, 4-7, 12-15, put back in order
+		__m256i words = _mm256_packus_epi32(gray_sums_avx2(p0, coeffs),
+						    gray_sums_avx2(p1, coeffs));
+		words = _mm256_permute4x64_epi64(words, _MM_SHUFFLE(3, 1, 2, 0));
+		_mm_storeu_si128((__m128i *)(gray + i),
+				 _mm_packus_epi16(_mm256_castsi256_si128(words),
+						  _mm256_extracti128_si256(words, 1)));
+	}
+	gray_row_sse41(bgra + i * 4, gray + i, count - i);
+}
+
+OCR_TARGET("sse4.1")
+void threshold_row_sse41(const uint8_t *src, uint8_t *dst, int count, uint8_t threshold)
+{
+	const __m128i limit = _mm_set1_epi8((char)threshold);
+	const __m128i zero = _mm_setzero_si128();
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		// above the threshold where the saturated difference is not zero
+		const __m128i above = _mm_subs_epu8(_mm_loadu_si128((const __m128i *)(src + i)),
+						    limit);
+		_mm_storeu_si128((__m128i *)(dst + i),
+				 _mm_andnot_si128(_mm_cmpeq_epi8(above, zero), _mm_set1_epi8(-1)));
+	}
+	threshold_row_scalar(src + i, dst + i, count - i, threshold);
+}
+
+OCR_TARGET("sse4.1")
+void absdiff_row_sse41(const uint8_t *a, const uint8_t *b, uint8_t *dst, int count)
+{
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		const __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+		const __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+		_mm_storeu_si128((__m128i *)(dst + i),
+				 _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va)));
+	}
+	absdiff_row_scalar(a + i, b + i, dst + i, count - i);
+}
+
+OCR_TARGET("sse4.1") uint64_t count_nonzero_row_sse41(const uint8_t *src, int count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi8(1);
+	// zero bytes as ones, summed by psadbw into two 64-bit counts
+	__m128i zeros = _mm_setzero_si128();
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		const __m128i is_zero = _mm_and_si128(
+			_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(src + i)), zero), one);
+		zeros = _mm_add_epi64(zeros, _mm_sad_epu8(is_zero, zero));
+	}
+	// each half fits in 32 bits for any row, which also keeps this 32-bit x86 friendly
+	const uint64_t zero_count = (uint64_t)(uint32_t)_mm_cvtsi128_si32(zeros) +
+				    (uint32_t)_mm_cvtsi128_si32(_mm_unpackhi_epi64(zeros, zeros));
+	return (uint64_t)i - zero_count + count_nonzero_row_scalar(src + i, count - i);
+}
+
+OCR_TARGET("sse4.1")
+void max3x3_row_sse41(const uint8_t *above, const uint8_t *row, const uint8_t *below,
+		      uint8_t *dst, int count, int channels)
+{
+	int i = channels;
+	for (; i + 16 + channels <= count; i += 16) {
+		__m128i value = _mm_setzero_si128();
+		for (const uint8_t *line : {above, row, below}) {
+			const __m128i *left = (const __m128i *)(line + i - channels);
+			const __m128i *right = (const __m128i *)(line + i + channels);
+			value = _mm_max_epu8(value, _mm_loadu_si128(left));
+			value = _mm_max_epu8(value, _mm_loadu_si128((const __m128i *)(line + i)));
+			value = _mm_max_epu8(value, _mm_loadu_si128(right));
+		}
+		_mm_storeu_si128((__m128i *)(dst + i), value);
+	}
+	// the scalar kernel starts at its first byte with a left neighbor
+	max3x3_row_scalar(above + i - channels, row + i - channels, below + i - channels,
+			  dst + i - channels, count - i + channels, channels);
+}
+
+OCR_TARGET("sse4.1") bool pack_row_sse41(const uint8_t *src, uint8_t *bits, int count)
+{
+	const uint8_t *reversed = reversed_bits();
+	const __m128i white = _mm_set1_epi8(-1);
+	const __m128i black = _mm_setzero_si128();
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		const __m128i pixels = _mm_loadu_si128((const __m128i *)(src + i));
+		const __m128i binary = _mm_or_si128(_mm_cmpeq_epi8(pixels, white),
+						    _mm_cmpeq_epi8(pixels, black));
+		if (_mm_movemask_epi8(binary) != 0xFFFF) {
+			return false;
+		}
+		const int mask = _mm_movemask_epi8(pixels);
+		bits[i / 8] = reversed[mask & 0xFF];
+		bits[i / 8 + 1] = reversed[(mask >> 8) & 0xFF];
+	}
+	return pack_row_scalar(src + i, bits + i / 8, count - i);
+}
+
+OCR_TARGET("avx2")
+void threshold_row_avx2(const uint8_t *src, uint8_t *dst, int count, uint8_t threshold)
+{
+	const __m256i limit = _mm256_set1_epi8((char)threshold);
+	const __m256i zero = _mm256_setzero_si256();
+	int i = 0;
+	for (; i + 32 <= count; i += 32) {
+		const __m256i above = _mm256_subs_epu8(
+			_mm256_loadu_si256((const __m256i *)(src + i)), limit);
+		_mm256_storeu_si256(
+			(__m256i *)(dst + i),
+			_mm256_andnot_si256(_mm256_cmpeq_epi8(above, zero), _mm256_set1_epi8(-1)));
+	}
+	threshold_row_sse41(src + i, dst + i, count - i, threshold);
+}
+
+OCR_TARGET("avx2")
+void absdiff_row_avx2(const uint8_t *a, const uint8_t *b, uint8_t *dst, int count)
+{
+	int i = 0;
+	for (; i + 32 <= count; i += 32) {
+		const __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+		const __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+		_mm256_storeu_si256((__m256i *)(dst + i),
+				    _mm256_or_si256(_mm256_subs_epu8(va, vb),
+						    _mm256_subs_epu8(vb, va)));
+	}
+	absdiff_row_sse41(a + i, b + i, dst + i, count - i);
+}
+
+OCR_TARGET("avx2") uint64_t count_nonzero_row_avx2(const uint8_t *src, int count)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi8(1);
+	__m256i zeros = _mm256_setzero_si256();
+	int i = 0;
+	for (; i + 32 <= count; i += 32) {
+		const __m256i is_zero = _mm256_and_si256(
+			_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(src + i)), zero),
+			one);
+		zeros = _mm256_add_epi64(zeros, _mm256_sad_epu8(is_zero, zero));
+	}
+	const __m128i halves = _mm_add_epi64(_mm256_castsi256_si128(zeros),
+					     _mm256_extracti128_si256(zeros, 1));
+	const uint64_t zero_count = (uint64_t)(uint32_t)_mm_cvtsi128_si32(halves) +
+				    (uint32_t)_mm_cvtsi128_si32(_mm_unpackhi_epi64(halves, halves));
+	return (uint64_t)i - zero_count + count_nonzero_row_sse41(src + i, count - i);
+}
+
+OCR_TARGET("avx2")
+void max3x3_row_avx2(const uint8_t *above, const uint8_t *row, const uint8_t *below,
+		     uint8_t *dst, int count, int channels)
+{
+	int i = channels;
+	for (; i + 32 + channels <= count; i += 32) {
+		__m256i value = _mm256_setzero_si256();
+		for (const uint8_t *line : {above, row, below}) {
+			value = _mm256_max_epu8(
+				value, _mm256_loadu_si256((const __m256i *)(line + i - channels)));
+			value = _mm256_max_epu8(value,
+						_mm256_loadu_si256((const __m256i *)(line + i)));
+			value = _mm256_max_epu8(
+				value, _mm256_loadu_si256((const __m256i *)(line + i + channels)));
+		}
+		_mm256_storeu_si256((__m256i *)(dst + i), value);
+	}
+	max3x3_row_sse41(above + i - channels, row + i - channels, below + i - channels,
+			 dst + i - channels, count - i + channels, channels);
+}
+
+OCR_TARGET("avx2") bool pack_row_avx2(const uint8_t *src, uint8_t *bits, int count)
+{
+	const uint8_t *reversed = reversed_bits();
+	const __m256i white = _mm256_set1_epi8(-1);
+	const __m256i black = _mm256_setzero_si256();
+	int i = 0;
+	for (; i + 32 <= count; i += 32) {
+		const __m256i pixels = _mm256_loadu_si256((const __m256i *)(src + i));
+		const __m256i binary = _mm256_or_si256(_mm256_cmpeq_epi8(pixels, white),
+						       _mm256_cmpeq_epi8(pixels, black));
+		if ((uint32_t)_mm256_movemask_epi8(binary) != 0xFFFFFFFFu) {
+			return false;
+		}
+		const uint32_t mask = (uint32_t)_mm256_movemask_epi8(pixels);
+		for (int byte = 0; byte < 4; byte++) {
+			bits[i / 8 + byte] = reversed[(mask >> (8 * byte)) & 0xFF];
+		}
+	}
+	return pack_row_sse41(src + i, bits + i / 8, count - i);
+}
+
+#endif
+
+#if defined(OCR_SIMD_NEON)
+
+void gray_row_neon(const uint8_t *bgra, uint8_t *gray, int count)
+{
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		// deinterleaved into B, G, R and A
+		const uint8x8x4_t pixels = vld4_u8(bgra + i * 4);
+		const uint16x8_t b = vmovl_u8(pixels.val[0]);
+		const uint16x8_t g = vmovl_u8(pixels.val[1]);
+		const uint16x8_t r = vmovl_u8(pixels.val[2]);
+		uint32x4_t lo = vmull_n_u16(vget_low_u16(b), B2Y);
+		lo = vmlal_n_u16(lo, vget_low_u16(g), G2Y);
+		lo = vmlal_n_u16(lo, vget_low_u16(r), R2Y);
+		uint32x4_t hi = vmull_n_u16(vget_high_u16(b), B2Y);
+		hi = vmlal_n_u16(hi, vget_high_u16(g), G2Y);
+		hi = vmlal_n_u16(hi, vget_high_u16(r), R2Y);
+		// the rounding shift adds GRAY_ROUND
+		const uint16x8_t words =
+			vcombine_u16(vrshrn_n_u32(lo, GRAY_SHIFT), vrshrn_n_u32(hi, GRAY_SHIFT));
+		vst1_u8(gray + i, vmovn_u16(words));
+	}
+	gray_row_scalar(bgra + i * 4, gray + i, count - i);
+}
+
+void threshold_row_neon(const uint8_t *src, uint8_t *dst, int count, uint8_t threshold)
+{
+	const uint8x16_t limit = vdupq_n_u8(threshold);
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		vst1q_u8(dst + i, vcgtq_u8(vld1q_u8(src + i), limit));
+	}
+	threshold_row_scalar(src + i, dst + i, count - i, threshold);
+}
+
+void absdiff_row_neon(const uint8_t *a, const uint8_t *b, uint8_t *dst, int count)
+{
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		vst1q_u8(dst + i, vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+	}
+	absdiff_row_scalar(a + i, b + i, dst + i, count - i);
+}
+
+uint64_t count_nonzero_row_neon(const uint8_t *src, int count)
+{
+	uint64_t nonzero = 0;
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		// ones where not zero, added across the vector
+		nonzero += vaddlvq_u8(vminq_u8(vld1q_u8(src + i), vdupq_n_u8(1)));
+	}
+	return nonzero + count_nonzero_row_scalar(src + i, count - i);
+}
+
+void max3x3_row_neon(const uint8_t *above, const uint8_t *row, const uint8_t *below,
+		     uint8_t *dst, int count, int channels)
+{
+	int i = channels;
+	for (; i + 16 + channels <= count; i += 16) {
+		uint8x16_t value = vdupq_n_u8(0);
+		for (const uint8_t *line : {above, row, below}) {
+			value = vmaxq_u8(value, vld1q_u8(line + i - channels));
+			value = vmaxq_u8(value, vld1q_u8(line + i));
+			value = vmaxq_u8(value, vld1q_u8(line + i + channels));
+		}
+		vst1q_u8(dst + i, value);
+	}
+	max3x3_row_scalar(above + i - channels, row + i - channels, below + i - channels,
+			  dst + i - channels, count - i + channels, channels);
+}
+
+bool pack_row_neon(const uint8_t *src, uint8_t *bits, int count)
+{
+	// the bit of each pixel, most significant first; the sum of distinct bits is their or
+	static const uint8_t bit_values[8] = {128, 64, 32, 16, 8, 4, 2, 1};
+	const uint8x8_t weights = vld1_u8(bit_values);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const uint8x8_t pixels = vld1_u8(src + i);
+		const uint8x8_t binary =
+			vorr_u8(vceq_u8(pixels, vdup_n_u8(0)), vceq_u8(pixels, vdup_n_u8(255)));
+		if (vminv_u8(binary) != 255) {
+			return false;
+		}
+		bits[i / 8] = vaddv_u8(vand_u8(pixels, weights));
+	}
+	return pack_row_scalar(src + i, bits + i / 8, count - i);
+}
+
+#endif
+
+struct kernel_table {
+	gray_row_fn gray_row;
+	threshold_row_fn threshold_row;
+	absdiff_row_fn absdiff_row;
+	count_nonzero_row_fn count_nonzero_row;
+	max3x3_row_fn max3x3_row;
+	pack_row_fn pack_row;
+};
+
+const kernel_table SCALAR_KERNELS = {
+	gray_row_scalar,
+	threshold_row_scalar,
+	absdiff_row_scalar,
+	count_nonzero_row_scalar,
+	max3x3_row_scalar,
+	pack_row_scalar,
+};
+#if defined(OCR_SIMD_X86)
+const kernel_table SSE41_KERNELS = {
+	gray_row_sse41,
+	threshold_row_sse41,
+	absdiff_row_sse41,
+	count_nonzero_row_sse41,
+	max3x3_row_sse41,
+	pack_row_sse41,
+};
+const kernel_table AVX2_KERNELS = {
+	gray_row_avx2,
+	threshold_row_avx2,
+	absdiff_row_avx2,
+	count_nonzero_row_avx2,
+	max3x3_row_avx2,
+	pack_row_avx2,
+};
+#endif
+#if defined(OCR_SIMD_NEON)
+const kernel_table NEON_KERNELS = {
+	gray_row_neon,
+	threshold_row_neon,
+	absdiff_row_neon,
+	count_nonzero_row_neon,
+	max3x3_row_neon,
+	pack_row_neon,
+};
+#endif
+
+// The kernels of the level, the scalar ones if the CPU does not support it
+const kernel_table &kernels_for(simd_level level)
+{
+	if (!simd_level_supported(level)) {
+		return SCALAR_KERNELS;
+	}
+	switch (level) {
+#if defined(OCR_SIMD_X86)
+	case SIMD_LEVEL_SSE41:
+		return SSE41_KERNELS;
+	case SIMD_LEVEL_AVX2:
+		return AVX2_KERNELS;
+#endif
+#if defined(OCR_SIMD_NEON)
+	case SIMD_LEVEL_NEON:
+		return NEON_KERNELS;
+#endif
+	default:
+		return SCALAR_KERNELS;
+	}
+}
+
+// Threshold a grayscale image, with cv::threshold's handling of thresholds out of range
+void threshold_image(const cv::Mat &gray, cv::Mat &binary, int threshold, const kernel_table &k)
+{
+	binary.create(gray.size(), CV_8UC1);
+	if (threshold < 0 || threshold >= 255) {
+		binary.setTo(threshold < 0 ? 255 : 0);
+		return;
+	}
+	for (int y = 0; y < gray.rows; y++) {
+		k.threshold_row(gray.ptr<uint8_t>(y), binary.ptr<uint8_t>(y), gray.cols,
+				(uint8_t)threshold);
+	}
+}
+
+template<global_threshold_method Method>
+int binarize_with(const cv::Mat &image, cv::Mat &binary, int threshold, const kernel_table &k)
+{
+	if constexpr (Method == GLOBAL_THRESHOLD_FIXED) {
+		if (image.channels() == 1) {
+			threshold_image(image, binary, threshold, k);
+			return threshold;
+		}
+		// convert a row at a time, the grayscale image is never needed whole
+		binary.create(image.size(), CV_8UC1);
+		thread_local std::vector<uint8_t> gray_row;
+		gray_row.resize((size_t)image.cols);
+		const bool all = threshold < 0;
+		const bool none = threshold >= 255;
+		for (int y = 0; y < image.rows; y++) {
+			uint8_t *out = binary.ptr<uint8_t>(y);
+			if (all || none) {
+				std::fill(out, out + image.cols, all ? 255 : 0);
+				continue;
+			}
+			k.gray_row(image.ptr<uint8_t>(y), gray_row.data(), image.cols);
+			k.threshold_row(gray_row.data(), out, image.cols, (uint8_t)threshold);
+		}
+		return threshold;
+	} else {
+		cv::Mat gray;
+		if (image.channels() == 1) {
+			gray = image;
+		} else {
+			gray.create(image.size(), CV_8UC1);
+			for (int y = 0; y < image.rows; y++) {
+				k.gray_row(image.ptr<uint8_t>(y), gray.ptr<uint8_t>(y), image.cols);
+			}
+		}
+		uint32_t histogram[256];
+		gray_histogram(gray, histogram);
+		const int derived = Method == GLOBAL_THRESHOLD_OTSU ? otsu_threshold(histogram)
+								    : triangle_threshold(histogram);
+		threshold_image(gray, binary, derived, k);
+		return derived;
+	}
+}
+
+} // namespace
+
+bool simd_level_supported(simd_level level)
+{
+	switch (level) {
+	case SIMD_LEVEL_SCALAR:
+		return true;
+#if defined(OCR_SIMD_X86)
+	case SIMD_LEVEL_SSE41:
+		return detect_x86_features().sse41;
+	case SIMD_LEVEL_AVX2:
+		return detect_x86_features().avx2;
+#endif
+#if defined(OCR_SIMD_NEON)
+	case SIMD_LEVEL_NEON:
+		// always there on 64-bit ARM
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+simd_level simd_best_level()
+{
+	static const simd_level best = [] {
+		for (int level = SIMD_LEVEL_COUNT - 1; level > SIMD_LEVEL_SCALAR; level--) {
+			if (simd_level_supported((simd_level)level)) {
+				return (simd_level)level;
+			}
+		}
+		return SIMD_LEVEL_SCALAR;
+	}();
+	return best;
+}
+
+const char *simd_level_name(simd_level level)
+{
+	switch (level) {
+	case SIMD_LEVEL_SCALAR:
+		return "scalar";
+	case SIMD_LEVEL_SSE41:
+		return "sse4.1";
+	case SIMD_LEVEL_AVX2:
+		return "avx2";
+	case SIMD_LEVEL_NEON:
+		return "neon";
+	default:
+		return "unknown";
+	}
+}
+
+void bgra_to_gray(const cv::Mat &bgra, cv::Mat &gray, simd_level level)
+{
+	const kernel_table &k = kernels_for(level);
+	gray.create(bgra.size(), CV_8UC1);
+	for (int y = 0; y < bgra.rows; y++) {
+		k.gray_row(bgra.ptr<uint8_t>(y), gray.ptr<uint8_t>(y), bgra.cols);
+	}
+}
+
+int binarize_global(const cv::Mat &image, cv::Mat &binary, global_threshold_method method,
+		    int threshold, simd_level level)
+{
+	const kernel_table &k = kernels_for(level);
+	switch (method) {
+	case GLOBAL_THRESHOLD_OTSU:
+		return binarize_with<GLOBAL_THRESHOLD_OTSU>(image, binary, threshold, k);
+	case GLOBAL_THRESHOLD_TRIANGLE:
+		return binarize_with<GLOBAL_THRESHOLD_TRIANGLE>(image, binary, threshold, k);
+	default:
+		return binarize_with<GLOBAL_THRESHOLD_FIXED>(image, binary, threshold, k);
+	}
+}
+
+void gray_histogram(const cv::Mat &gray, uint32_t histogram[256])
+{
+	// four partial histograms, so consecutive equal pixels do not wait on each other
+	uint32_t partial[4][256] = {};
+	for (int y = 0; y < gray.rows; y++) {
+		const uint8_t *row = gray.ptr<uint8_t>(y);
+		int x = 0;
+		for (; x + 4 <= gray.cols; x += 4) {
+			partial[0][row[x]]++;
+			partial[1][row[x + 1]]++;
+			partial[2][row[x + 2]]++;
+			partial[3][row[x + 3]]++;
+		}
+		for (; x < gray.cols; x++) {
+			partial[0][row[x]]++;
+		}
+	}
+	for (int i = 0; i < 256; i++) {
+		histogram[i] = partial[0][i] + partial[1][i] + partial[2][i] + partial[3][i];
+	}
+}
+
+int otsu_threshold(const uint32_t histogram[256])
+{
+	// as cv::threshold with THRESH_OTSU: the threshold maximizing the between-class variance
+	uint64_t total = 0;
+	double mu = 0.0;
+	for (int i = 0; i < 256; i++) {
+		total += histogram[i];
+		mu += i * (double)histogram[i];
+	}
+	if (total == 0) {
+		return 0;
+	}
+	const double scale = 1.0 / (double)total;
+	mu *= scale;
+	double mu1 = 0.0;
+	double q1 = 0.0;
+	double max_sigma = 0.0;
+	int threshold = 0;
+	for (int i = 0; i < 256; i++) {
+		const double p_i = histogram[i] * scale;
+		mu1 *= q1;
+		q1 += p_i;
+		const double q2 = 1.0 - q1;
+		if (std::min(q1, q2) < FLT_EPSILON || std::max(q1, q2) > 1.0 - FLT_EPSILON) {
+			continue;
+		}
+		mu1 = (mu1 + i * p_i) / q1;
+		const double mu2 = (mu - q1 * mu1) / q2;
+		const double sigma = q1 * q2 * (mu1 - mu2) * (mu1 - mu2);
+		if (sigma > max_sigma) {
+			max_sigma = sigma;
+			threshold = i;
+		}
+	}
+	return threshold;
+}
+
+int triangle_threshold(const uint32_t histogram[256])
+{
+	// as cv::threshold with THRESH_TRIANGLE: the farthest point of the histogram from the
+	// line between its peak and the end of its longer tail
+	const int N = 256;
+	int h[N];
+	std::copy(histogram, histogram + N, h);
+	int left_bound = 0;
+	int right_bound = 0;
+	int max_ind = 0;
+	int max = 0;
+	for (int i = 0; i < N; i++) {
+		if (h[i] > 0) {
+			left_bound = i;
+			break;
+		}
+	}
+	if (left_bound > 0) {
+		left_bound--;
+	}
+	for (int i = N - 1; i > 0; i--) {
+		if (h[i] > 0) {
+			right_bound = i;
+			break;
+		}
+	}
+	if (right_bound < N - 1) {
+		right_bound++;
+	}
+	for (int i = 0; i < N; i++) {
+		if (h[i] > max) {
+			max = h[i];
+			max_ind = i;
+		}
+	}
+	const bool flipped = max_ind - left_bound < right_bound - max_ind;
+	if (flipped) {
+		std::reverse(h, h + N);
+		left_bound = N - 1 - right_bound;
+		max_ind = N - 1 - max_ind;
+	}
+	int threshold = left_bound;
+	const double a = max;
+	const double b = left_bound - max_ind;
+	double dist = 0.0;
+	for (int i = left_bound + 1; i <= max_ind; i++) {
+		const double tempdist = a * i + b * h[i];
+		if (tempdist > dist) {
+			dist = tempdist;
+			threshold = i;
+		}
+	}
+	threshold--;
+	return flipped ? N - 1 - threshold : threshold;
+}
+
+uint64_t count_changed_pixels(const cv::Mat &a, const cv::Mat &b, simd_level level)
+{
+	const kernel_table &k = kernels_for(level);
+	const int row_bytes = a.cols * (int)a.elemSize();
+	thread_local std::vector<uint8_t> diff;
+	thread_local std::vector<uint8_t> diff_gray;
+	diff.resize((size_t)row_bytes);
+	diff_gray.resize((size_t)a.cols);
+	uint64_t changed = 0;
+	for (int y = 0; y < a.rows; y++) {
+		k.absdiff_row(a.ptr<uint8_t>(y), b.ptr<uint8_t>(y), diff.data(), row_bytes);
+		if (a.channels() == 4) {
+			k.gray_row(diff.data(), diff_gray.data(), a.cols);
+			changed += k.count_nonzero_row(diff_gray.data(), a.cols);
+		} else {
+			changed += k.count_nonzero_row(diff.data(), row_bytes);
+		}
+	}
+	return changed;
+}
+
+void dilate_3x3(const cv::Mat &src, cv::Mat &dst, int iterations, simd_level level)
+{
+	const kernel_table &k = kernels_for(level);
+	const int channels = src.channels();
+	const int row_bytes = src.cols * channels;
+	cv::Mat input = src;
+	for (int iteration = 0; iteration < std::max(1, iterations); iteration++) {
+		// a new output each time, the input may be src or dst
+		cv::Mat output(src.size(), src.type());
+		for (int y = 0; y < src.rows; y++) {
+			// rows and columns past the border do not count, as with OpenCV's default
+			// border for dilation
+			const uint8_t *above = input.ptr<uint8_t>(std::max(0, y - 1));
+			const uint8_t *row = input.ptr<uint8_t>(y);
+			const uint8_t *below = input.ptr<uint8_t>(std::min(src.rows - 1, y + 1));
+			uint8_t *out = output.ptr<uint8_t>(y);
+			k.max3x3_row(above, row, below, out, row_bytes, channels);
+			for (int c = 0; c < channels && c < row_bytes; c++) {
+				const int last = row_bytes - channels + c;
+				uint8_t first_value = 0;
+				uint8_t last_value = 0;
+				for (const uint8_t *line : {above, row, below}) {
+					first_value = std::max(first_value, line[c]);
+					last_value = std::max(last_value, line[last]);
+					if (c + channels < row_bytes) {
+						first_value =
+							std::max(first_value, line[c + channels]);
+						last_value =
+							std::max(last_value, line[last - channels]);
+					}
+				}
+				out[c] = first_value;
+				out[last] = last_value;
+			}
+		}
+		input = output;
+	}
+	dst = input;
+}
+
+bool pack_binary(const cv::Mat &binary, std::vector<uint8_t> &bits, int &bytes_per_line,
+		 simd_level level)
+{
+	const kernel_table &k = kernels_for(level);
+	bytes_per_line = (binary.cols + 7) / 8;
+	bits.resize((size_t)bytes_per_line * binary.rows);
+	for (int y = 0; y < binary.rows; y++) {
+		if (!k.pack_row(binary.ptr<uint8_t>(y), bits.data() + (size_t)y * bytes_per_line,
+				binary.cols)) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,82 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+// Image kernels of the capture and preprocessing paths, compiled for several instruction sets
+// and picked at runtime for the CPU. Free of OBS types. The results match the OpenCV calls
+// they replace, obs-ocr-benchmark --verify-kernels checks them against OpenCV.
+
+#include <opencv2/core/mat.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum simd_level {
+	SIMD_LEVEL_SCALAR,
+	SIMD_LEVEL_SSE41,
+	SIMD_LEVEL_AVX2,
+	SIMD_LEVEL_NEON,
+	SIMD_LEVEL_COUNT,
+};
+
+// The best level the CPU supports, detected once
+simd_level simd_best_level();
+bool simd_level_supported(simd_level level);
+const char *simd_level_name(simd_level level);
+
+// As cv::cvtColor(COLOR_BGRA2GRAY), reading each row of bgra once, e.g. straight out of a
+// mapped staging surface. gray is reallocated only if its size or type differ
+void bgra_to_gray(const cv::Mat &bgra, cv::Mat &gray, simd_level level = simd_best_level());
+
+// How binarize_global finds its threshold
+enum global_threshold_method {
+	GLOBAL_THRESHOLD_FIXED,
+	GLOBAL_THRESHOLD_OTSU,
+	GLOBAL_THRESHOLD_TRIANGLE,
+};
+
+/**
+  * @brief Binarize with one threshold for the whole image, as cv::threshold with THRESH_BINARY
+  * and a max value of 255, or with THRESH_OTSU or THRESH_TRIANGLE.
+  *
+  * Each method is a separate specialization, so the per-pixel loops do not branch on it. A
+  * BGRA image is converted to grayscale on the way, row by row for a fixed threshold.
+  *
+  * @param image  BGRA or grayscale
+  * @param binary  The output, 0 or 255
+  * @param method  Where the threshold comes from
+  * @param threshold  The threshold of GLOBAL_THRESHOLD_FIXED, pixels above it become 255
+  * @return the threshold used
+*/
+int binarize_global(const cv::Mat &image, cv::Mat &binary, global_threshold_method method,
+		    int threshold, simd_level level = simd_best_level());
+
+// Histogram of a grayscale image, and the thresholds cv::threshold derives from it
+void gray_histogram(const cv::Mat &gray, uint32_t histogram[256]);
+int otsu_threshold(const uint32_t histogram[256]);
+int triangle_threshold(const uint32_t histogram[256]);
+
+/**
+  * @brief Count the pixels that differ between two images of the same size and type.
+  *
+  * BGRA pixels count when the grayscale of their absolute difference is not zero, as
+  * cv::absdiff, cv::cvtColor and cv::countNonZero do in turn.
+*/
+uint64_t count_changed_pixels(const cv::Mat &a, const cv::Mat &b,
+			      simd_level level = simd_best_level());
+
+// As cv::dilate with a 3x3 rectangle, for grayscale and BGRA images
+void dilate_3x3(const cv::Mat &src, cv::Mat &dst, int iterations,
+		simd_level level = simd_best_level());
+
+/**
+  * @brief Pack a binary grayscale image to one bit per pixel, the most significant bit first
+  * and 1 for white, the layout Tesseract takes for binary images.
+  *
+  * @param bits  The packed rows, bytes_per_line apart
+  * @return false if a pixel is neither 0 nor 255, bits is then incomplete
+*/
+bool pack_binary(const cv::Mat &binary, std::vector<uint8_t> &bits, int &bytes_per_line,
+		 simd_level level = simd_best_level());
+
+#endif /* SIMD_KERNELS_H */
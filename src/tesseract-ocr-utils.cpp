@@ -3,8 +3,16 @@
 #include "obs-utils.h"
 #include "consts.h"
 #include "text-render-helper.h"
+#include "ocr-trace.h"
+#include "frame-recorder.h"
+#include "model-pool.h"
+#include "plugin-config.h"
+#include "simd-kernels.h"
+#include "box-tracker.h"
+#include "redaction.h"
 
 #include <obs-module.h>
+#include <util/platform.h>
 
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
@@ -13,6 +21,7 @@
 
 #include <inja/inja.hpp>
 
+#include <cstdio>
 #include <string>
 #include <fstream>
 #include <deque>
@@ -20,12 +29,17 @@
 #include <algorithm>
 #include <thread>
 
-inline uint64_t get_time_ns(void)
-{
-	return std::chrono::duration_cast<std::chrono::nanoseconds>(
-		       std::chrono::system_clock::now().time_since_epoch())
-		.count();
-}
+// how often a rolling trace is written to disk
+const uint64_t TRACE_ROLLING_INTERVAL_NS = 10ULL * 1000000000ULL;
+// how often the frame counters and latency are logged
+const uint64_t STATS_LOG_INTERVAL_NS = 60ULL * 1000000000ULL;
+// how often the statistics shown in the filter properties are refreshed
+const uint64_t STATS_UPDATE_INTERVAL_NS = 1000000000ULL;
+// how often an inactive filter with a loaded model checks its idle unload period
+const std::chrono::seconds IDLE_CHECK_INTERVAL(1);
+// the delay before a model that failed to load is tried again, doubled up to the maximum
+const uint64_t MODEL_RETRY_MIN_NS = 1000000000ULL;
+const uint64_t MODEL_RETRY_MAX_NS = 60ULL * 1000000000ULL;
 
 void cleanup_config_files(const std::string &unique_id)
 {
@@ -47,22 +61,44 @@ void cleanup_config_files(const std::string &unique_id)
 	std::filesystem::remove(mask_filepath.c_str());
 }
 
+std::shared_ptr<ocr_model> load_filter_model(filter_data *tf)
+{
+	// the user patterns config file is written by initialize_tesseract_ocr
+	std::string patterns_config_filepath;
+	std::vector<char *> configs;
+	if (!tf->user_patterns.empty()) {
+		std::string filename = "user-patterns" + tf->unique_id + ".config";
+		char *config_path = obs_module_config_path(filename.c_str());
+		patterns_config_filepath = config_path;
+		bfree(config_path);
+		configs.push_back(&patterns_config_filepath[0]);
+	}
+
+	// share a loaded model when asked to or to stay within the memory budget
+	const bool share_model = get_plugin_config()->share_models || ocr_memory_over_budget();
+	obs_log(LOG_INFO, "Loading tesseract model from: %s%s", tf->tesseractTraineddataFilepath,
+		share_model ? " (shared if already loaded)" : "");
+
+	std::shared_ptr<ocr_model> model = acquire_ocr_model(
+		tf->tesseractTraineddataFilepath, tf->language,
+		configs.empty() ? nullptr : configs.data(), (int)configs.size(), share_model);
+	// preload the language when OBS starts next time
+	plugin_config_record_language(tf->language.c_str());
+	return model;
+}
+
 void initialize_tesseract_ocr(filter_data *tf, bool hard_tesseract_init_required)
 {
 	try {
 		if (hard_tesseract_init_required) {
 			stop_and_join_tesseract_thread(tf);
-			if (tf->tesseract_model != nullptr) {
-				tf->tesseract_model->End();
-				delete tf->tesseract_model;
-				tf->tesseract_model = nullptr;
-			}
+			tf->tesseract_model.reset();
 		}
 
 		std::lock_guard<std::mutex> lock(tf->tesseract_settings_mutex);
-
-		char **configs = nullptr;
-		int configs_size = 0;
+		// new settings may fix a model that failed to load, try it again right away
+		tf->modelRetryAtNs = 0;
+		tf->modelRetryDelayNs = 0;
 
 		if (is_valid_output_source_name(tf->output_image_source_name)) {
 			// make sure mask folder exists
@@ -92,38 +128,17 @@ void initialize_tesseract_ocr(filter_data *tf, bool hard_tesseract_init_required
 			patterns_config_file << "user_patterns_file " << user_patterns_filepath
 					     << "\n";
 			patterns_config_file.close();
-
-			// add the config file to the configs array
-			configs_size = 1;
-			configs = new char *[configs_size];
-			configs[0] = new char[patterns_config_filepath.length() + 1];
-			strcpy(configs[0], patterns_config_filepath.c_str());
 		}
 
 		if (hard_tesseract_init_required) {
-			obs_log(LOG_INFO, "Loading tesseract model from: %s",
-				tf->tesseractTraineddataFilepath);
-
-			tf->tesseract_model = new tesseract::TessBaseAPI();
-
-			// Load model
-			int retval = tf->tesseract_model->Init(tf->tesseractTraineddataFilepath,
-							       tf->language.c_str(),
-							       tesseract::OEM_LSTM_ONLY, configs,
-							       configs_size, nullptr, nullptr,
-							       false);
-			if (retval != 0) {
-				throw std::runtime_error("Failed to initialize tesseract model");
-			}
+			tf->tesseract_model = load_filter_model(tf);
 		}
 
-		// set tesseract page segmentation mode
-		tf->tesseract_model->SetPageSegMode(
-			static_cast<tesseract::PageSegMode>(tf->pageSegmentationMode));
-
-		// apply char whitlist
-		tf->tesseract_model->SetVariable("tessedit_char_whitelist",
-						 tf->char_whitelist.c_str());
+		if (tf->tesseract_model) {
+			std::lock_guard<std::mutex> model_lock(tf->tesseract_model->mutex);
+			apply_tesseract_settings(tf->tesseract_model->api,
+						 tf->pageSegmentationMode, tf->char_whitelist);
+		}
 
 		if (tf->enable_smoothing) {
 			tf->smoothing_filter = std::make_unique<CharacterBasedSmoothingFilter>(
@@ -141,38 +156,46 @@ void initialize_tesseract_ocr(filter_data *tf, bool hard_tesseract_init_required
 	}
 }
 
-std::string strip(const std::string &str)
+ocr_pipeline_settings get_pipeline_settings(filter_data *tf)
 {
-	size_t start = str.find_first_not_of(" \t\n\r");
-	size_t end = str.find_last_not_of(" \t\n\r");
-
-	if (start == std::string::npos || end == std::string::npos)
-		return "";
-
-	return str.substr(start, end - start + 1);
+	ocr_pipeline_settings settings;
+	settings.language = tf->language;
+	settings.pageSegmentationMode = tf->pageSegmentationMode;
+	settings.binarizationMode = tf->binarizationMode;
+	settings.binarizationThreshold = tf->binarizationThreshold;
+	settings.binarizationBlockSize = tf->binarizationBlockSize;
+	settings.dilationIterations = tf->dilationIterations;
+	settings.rescaleImage = tf->rescaleImage;
+	settings.rescaleTargetSize = tf->rescaleTargetSize;
+	settings.char_whitelist = tf->char_whitelist;
+	settings.conf_threshold = tf->conf_threshold;
+	settings.enable_smoothing = tf->enable_smoothing;
+	settings.word_length = tf->word_length;
+	settings.window_size = tf->window_size;
+	settings.update_on_change = tf->update_on_change;
+	settings.update_on_change_threshold = tf->update_on_change_threshold;
+	return settings;
 }
 
-std::string run_tesseract_ocr(filter_data *tf, const cv::Mat &image)
+// Recognize the image without smoothing, empty if below the confidence threshold
+static std::string recognize_confident_text(filter_data *tf, const cv::Mat &image)
 {
-	// run the tesseract model
-	tf->tesseract_model->SetImage(image.data, image.cols, image.rows, image.channels(),
-				      (int)image.step);
-	char *text = tf->tesseract_model->GetUTF8Text();
-	if (text == nullptr) {
-		return "";
-	}
-	std::string recognitionResult = std::string(text);
-	delete[] text;
-
-	// get the confidence of the recognition result
-	const int confidence = tf->tesseract_model->MeanTextConf();
-
+	int confidence = 0;
+	std::string recognitionResult =
+		recognize_text(tf->tesseract_model->api, image, tf->conf_threshold, &confidence);
 	if (confidence < tf->conf_threshold) {
+		tf->counters.rejected_low_confidence.fetch_add(1, std::memory_order_relaxed);
 		return "";
 	}
+	if (recognitionResult.empty()) {
+		tf->counters.empty_results.fetch_add(1, std::memory_order_relaxed);
+	}
+	return recognitionResult;
+}
 
-	// strip whitespace from the beginning and end of the string
-	recognitionResult = strip(recognitionResult);
+std::string run_tesseract_ocr(filter_data *tf, const cv::Mat &image)
+{
+	std::string recognitionResult = recognize_confident_text(tf, image);
 
 	if (tf->enable_smoothing) {
 		recognitionResult = tf->smoothing_filter->add_reading(recognitionResult);
@@ -183,93 +206,135 @@ std::string run_tesseract_ocr(filter_data *tf, const cv::Mat &image)
 
 std::vector<OCRBox> extract_text_detection_boxes(filter_data *tf, cv::Size imageSize)
 {
-	// extract the text detection boxes
-	tesseract::ResultIterator *ri = tf->tesseract_model->GetIterator();
-	if (ri == nullptr) {
-		return std::vector<OCRBox>();
-	}
-	tesseract::PageIteratorLevel level = tesseract::RIL_WORD;
-	if (tf->pageSegmentationMode == tesseract::PSM_SINGLE_CHAR) {
-		level = tesseract::RIL_SYMBOL;
-	}
-	std::vector<OCRBox> boxes;
-	do {
-		if (ri->Empty(level)) {
-			continue;
-		}
-		// is this a word box?
-		if (level == tesseract::RIL_WORD) {
-			// get the confidence of the word
-			float conf = ri->Confidence(level);
-			if ((int)conf < tf->conf_threshold) {
-				continue;
+	return get_text_detection_boxes(tf->tesseract_model->api, tf->pageSegmentationMode,
+					tf->conf_threshold, imageSize);
+}
+
+/**
+  * @brief The text boxes of the image just given to OCR.
+  *
+  * @param tf  The filter data, with the model mutex held
+  * @param imageForOCR  The preprocessed image
+  * @param recognized  The text of the image was recognized, the boxes and their text are read
+  * from the result. Otherwise they are found by layout analysis alone and have no text.
+*/
+static std::vector<OCRBox> find_text_boxes(filter_data *tf, const cv::Mat &imageForOCR,
+					   bool recognized)
+{
+	if (recognized) {
+		return extract_text_detection_boxes(tf, imageForOCR.size());
+	}
+	tf->counters.layout_only.fetch_add(1, std::memory_order_relaxed);
+	return detect_layout_boxes(tf->tesseract_model->api, imageForOCR,
+				   tf->pageSegmentationMode);
+}
+
+/**
+  * @brief Run OCR on each region of interest of the frame.
+  *
+  * The regions are views into the frame, nothing is copied before preprocessing. Smoothing is
+  * applied once to the joined text so it sees the same readings as without regions.
+  *
+  * @param tf  The filter data, with the model mutex held
+  * @param image  The frame, a regions atlas or the downscaled source
+  * @param rois  Where each region is in the frame and in the source
+  * @param recognize  Whether to recognize the text, only the boxes are found otherwise
+  * @param image_output  Whether to extract the text boxes, for the image output or redaction
+  * @param boxes  The text boxes of all regions, in source coordinates
+  * @param region_texts  The text of each region, in the order of the regions setting
+  * @return the region texts joined with newlines
+*/
+static std::string run_regions_ocr(filter_data *tf, const cv::Mat &image, const roi_atlas &rois,
+				   bool recognize, bool image_output, std::vector<OCRBox> &boxes,
+				   std::vector<std::string> &region_texts)
+{
+	const ocr_pipeline_settings settings = get_pipeline_settings(tf);
+	std::string joined;
+	for (size_t i = 0; i < rois.tiles.size(); i++) {
+		OCR_TRACE_SPAN("region");
+		const cv::Rect &region = rois.regions[i];
+		cv::Mat imageForOCR = preprocess_image(image(rois.tiles[i]), settings, nullptr);
+
+		std::string text = recognize ? recognize_confident_text(tf, imageForOCR) : "";
+		if (image_output) {
+			std::vector<OCRBox> region_boxes =
+				find_text_boxes(tf, imageForOCR, recognize);
+			scale_boxes(region_boxes, imageForOCR.size(), region.size());
+			for (auto &box : region_boxes) {
+				box.box += region.tl();
+				boxes.push_back(box);
 			}
 		}
-		OCRBox box;
-		int left, top, right, bottom;
-		ri->BoundingBox(level, &left, &top, &right, &bottom);
-		box.box = cv::Rect(left, top, right - left, bottom - top);
-		// get the text of the box
-		const char *text = ri->GetUTF8Text(level);
-		box.text = text;
-		// get area of box
-		const int area = (right - left) * (bottom - top);
-		// if the area is too small or too big, relative to the image size - skip the box
-		if (area < 100 || area > (imageSize.width * imageSize.height) / 2) {
-			continue;
+		if (!text.empty()) {
+			joined += joined.empty() ? text : "\n" + text;
 		}
-		boxes.push_back(box);
-	} while (ri->Next(level));
-	delete ri;
+		region_texts.push_back(std::move(text));
+	}
 
-	return boxes;
+	if (tf->enable_smoothing) {
+		joined = tf->smoothing_filter->add_reading(joined);
+	}
+	return joined;
 }
 
-CharacterBasedSmoothingFilter::CharacterBasedSmoothingFilter(size_t word_length_,
-							     size_t window_size_)
-	: word_length(word_length_),
-	  window_size(window_size_),
-	  readings(word_length_, std::deque<char>(window_size_))
+/**
+  * @brief Run OCR on the part of the frame that scrolled into view since the last recognition.
+  *
+  * Smoothing does not apply, each strip shows different text.
+  *
+  * @param tf  The filter data, with the model mutex held
+  * @param image  The frame, BGRA or grayscale
+  * @param image_output  Whether to extract the text boxes, for the image output or redaction
+  * @param boxes  The text boxes of the strip, in source coordinates
+  * @param source_size  Size of the source the frame was downscaled from
+  * @param recognized  Set if a strip was recognized, the boxes are not updated otherwise
+  * @return the text not read before, empty if nothing new scrolled into view
+*/
+static std::string run_scroll_ocr(filter_data *tf, const cv::Mat &image, bool image_output,
+				  std::vector<OCRBox> &boxes, cv::Size source_size,
+				  bool &recognized)
 {
-}
+	const scroll_mode mode = (scroll_mode)tf->scrollMode;
+	if (tf->scroll.mode() != mode) {
+		tf->scroll.reset(mode);
+	}
+	cv::Mat gray;
+	{
+		OCR_TRACE_SPAN("scroll_estimate");
+		to_grayscale(image, gray);
+	}
+	const cv::Rect strip = tf->scroll.plan(gray);
+	recognized = !strip.empty();
+	if (!recognized) {
+		return tf->scroll.idle();
+	}
+	if (strip.size() != image.size()) {
+		tf->counters.scroll_strips.fetch_add(1, std::memory_order_relaxed);
+	}
 
-std::string CharacterBasedSmoothingFilter::add_reading(const std::string &inWord)
-{
-	std::string word = inWord;
-	if (word.length() != word_length) {
-		// trim the word if it's longer than the expected length
-		if (word.length() > this->word_length)
-			word = word.substr(0, this->word_length);
-		// pad the word if it's shorter than the expected length
-		if (word.length() < this->word_length)
-			word = word + std::string(this->word_length - word.length(), ' ');
-	}
-
-	std::string smoothed_word;
-	for (size_t i = 0; i < word_length; i++) {
-		readings[i].push_back(word[i]);
-		if (readings[i].size() > window_size) {
-			readings[i].pop_front();
+	cv::Mat imageForOCR = preprocess_image(image(strip), get_pipeline_settings(tf), nullptr);
+	const std::string text = recognize_confident_text(tf, imageForOCR);
+	if (image_output) {
+		boxes = extract_text_detection_boxes(tf, imageForOCR.size());
+		scale_boxes(boxes, imageForOCR.size(), strip.size());
+		for (auto &box : boxes) {
+			box.box += strip.tl();
 		}
-		std::string window(readings[i].begin(), readings[i].end());
-		// find the most common character in the window
-		char most_common_char =
-			*std::max_element(window.begin(), window.end(), [window](char a, char b) {
-				return std::count(window.begin(), window.end(), a) <
-				       std::count(window.begin(), window.end(), b);
-			});
-		smoothed_word += most_common_char;
+		scale_boxes(boxes, image.size(), source_size);
 	}
-
-	return smoothed_word;
+	return tf->scroll.commit(text);
 }
 
 std::string format_text_with_template(inja::Environment &env, const std::string &text,
-				      struct filter_data *tf)
+				      struct filter_data *tf, uint64_t latency_ms,
+				      const std::vector<std::string> &region_texts)
 {
 	// Replace the {{output}} placeholder with the source text using inja
 	nlohmann::json data;
 	data["output"] = text;
+	data["latency_ms"] = latency_ms;
+	// the text of each region of interest, e.g. {{ at(regions, 0) }}
+	data["regions"] = region_texts;
 	return env.render(tf->output_format_template, data);
 }
 
@@ -289,6 +354,334 @@ void stop_and_join_tesseract_thread(struct filter_data *tf)
 	}
 }
 
+void wake_tesseract_thread(filter_data *tf)
+{
+	std::lock_guard<std::mutex> lock(tf->tesseract_mutex);
+	tf->tesseract_thread_cv.notify_all();
+}
+
+std::string memory_budget_summary()
+{
+	char buffer[128];
+	const uint64_t budget = ocr_memory_budget();
+	snprintf(buffer, sizeof(buffer), "All filters: %.1fMB of %s%s",
+		 (double)ocr_memory_total_bytes() / (1024.0 * 1024.0),
+		 budget > 0 ? (std::to_string(budget / (1024 * 1024)) + "MB").c_str() : "unlimited",
+		 ocr_memory_over_budget() ? " (over budget)" : "");
+	return buffer;
+}
+
+void log_filter_stats(filter_data *tf)
+{
+	obs_log(LOG_INFO, "[%s] frames: %s", obs_source_get_name(tf->source),
+		tf->counters.summary().c_str());
+	obs_log(LOG_INFO, "[%s] buffers: %s", obs_source_get_name(tf->source),
+		tf->arena.summary().c_str());
+	obs_log(LOG_INFO, "[%s] memory: %s, models: %s, %s", obs_source_get_name(tf->source),
+		tf->memory.summary().c_str(), ocr_model_pool_summary().c_str(),
+		memory_budget_summary().c_str());
+	if (tf->capture_to_output_latency.count() > 0) {
+		obs_log(LOG_INFO, "[%s] capture-to-output latency: %s",
+			obs_source_get_name(tf->source),
+			tf->capture_to_output_latency.summary().c_str());
+	}
+}
+
+void update_stats_surface(filter_data *tf)
+{
+	std::string stats = "Frames: " + tf->counters.summary();
+	if (tf->capture_to_output_latency.count() > 0) {
+		stats += "\nLatency: " + tf->capture_to_output_latency.summary();
+	}
+	stats += "\nModel: " + std::string(tf->tesseract_model ? "loaded" : "unloaded") +
+		 ", idle unloads=" + std::to_string(tf->model_unloads.load()) + ", warm-up " +
+		 tf->model_warmup.summary();
+	stats += "\nBuffers: " + tf->arena.summary();
+	stats += "\nMemory: " + tf->memory.summary() + "\nModels: " + ocr_model_pool_summary() +
+		 "\n" + memory_budget_summary();
+	obs_data_t *settings = obs_source_get_settings(tf->source);
+	obs_data_set_string(settings, "ocr_stats", stats.c_str());
+	obs_data_release(settings);
+}
+
+void release_idle_filter(filter_data *tf)
+{
+	tf->tesseract_model.reset();
+	{
+		std::lock_guard<std::mutex> lock(tf->inputBGRALock);
+		tf->inputBGRA.release();
+	}
+	{
+		std::lock_guard<std::mutex> lock(tf->outputPreviewLock);
+		tf->outputPreview.release();
+	}
+	tf->lastInputBGRA.release();
+	tf->tracker.clear();
+	tf->arena.trim();
+	for (int category = 0; category < OCR_MEMORY_CATEGORY_COUNT; category++) {
+		tf->memory.set(category, 0);
+	}
+	tf->model_unloads.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+  * @brief Load the filter's model unless a failed load is waiting for its retry delay.
+  *
+  * With tesseract_settings_mutex held.
+  *
+  * @return true if the model was loaded
+*/
+static bool load_model_with_backoff(filter_data *tf, uint64_t now_ns)
+{
+	if (now_ns < tf->modelRetryAtNs) {
+		return false;
+	}
+	try {
+		tf->tesseract_model = load_filter_model(tf);
+		std::lock_guard<std::mutex> model_lock(tf->tesseract_model->mutex);
+		apply_tesseract_settings(tf->tesseract_model->api, tf->pageSegmentationMode,
+					 tf->char_whitelist);
+	} catch (const std::exception &e) {
+		tf->tesseract_model.reset();
+		tf->modelRetryDelayNs =
+			tf->modelRetryDelayNs == 0
+				? MODEL_RETRY_MIN_NS
+				: std::min(tf->modelRetryDelayNs * 2, MODEL_RETRY_MAX_NS);
+		tf->modelRetryAtNs = now_ns + tf->modelRetryDelayNs;
+		obs_log(LOG_ERROR, "Failed to reload tesseract model, retrying in %.0f s: %s",
+			(double)tf->modelRetryDelayNs / 1e9, e.what());
+		return false;
+	}
+	tf->modelRetryAtNs = 0;
+	tf->modelRetryDelayNs = 0;
+	return true;
+}
+
+/**
+  * @brief Unload the model and buffers of a filter that stayed inactive for its idle period,
+  * and load the model back once the filter is active again.
+  *
+  * Runs on the OCR thread so loading doesn't stall OBS. An inactive filter is unloaded right
+  * away when all filters are over the memory budget. An inactive filter that is shown, e.g. in
+  * the studio mode preview, is about to go live: it keeps its model, or loads it ahead of
+  * activation within the budget. A model that fails to load is tried again after a delay that
+  * doubles on every failure, not on every frame.
+  *
+  * @return true if the model is loaded
+*/
+bool update_model_residency(filter_data *tf, uint64_t &inactive_since_ns)
+{
+	const uint64_t now_ns = get_time_ns();
+	std::lock_guard<std::mutex> lock(tf->tesseract_settings_mutex);
+
+	if (tf->isDisabled && tf->isShown) {
+		inactive_since_ns = 0;
+		if (tf->tesseract_model || ocr_memory_over_budget() ||
+		    !load_model_with_backoff(tf, now_ns)) {
+			return tf->tesseract_model != nullptr;
+		}
+		obs_log(LOG_INFO, "[%s] model loaded ahead of activation, the source is shown",
+			obs_source_get_name(tf->source));
+		return true;
+	}
+
+	if (tf->isDisabled) {
+		if (inactive_since_ns == 0) {
+			inactive_since_ns = now_ns;
+		}
+		const bool idle_expired = tf->idle_unload_seconds > 0 &&
+					  now_ns - inactive_since_ns >=
+						  (uint64_t)tf->idle_unload_seconds * 1000000000ULL;
+		if (tf->tesseract_model && (idle_expired || ocr_memory_over_budget())) {
+			obs_log(LOG_INFO, "[%s] inactive for %.0f s, unloading model",
+				obs_source_get_name(tf->source),
+				(double)(now_ns - inactive_since_ns) / 1e9);
+			release_idle_filter(tf);
+		}
+		return tf->tesseract_model != nullptr;
+	}
+
+	const uint64_t inactive_ns = inactive_since_ns > 0 ? now_ns - inactive_since_ns : 0;
+	inactive_since_ns = 0;
+	if (tf->tesseract_model) {
+		return true;
+	}
+	if (!load_model_with_backoff(tf, now_ns)) {
+		return false;
+	}
+	const uint64_t ready_ns = get_time_ns();
+	const uint64_t activated_ns = tf->activated_at_ns.load(std::memory_order_relaxed);
+	const uint64_t warmup_ns =
+		activated_ns > 0 && activated_ns <= now_ns ? ready_ns - activated_ns
+							   : ready_ns - now_ns;
+	tf->model_warmup.record(warmup_ns);
+	obs_log(LOG_INFO, "[%s] model ready %.1f ms after activation (%.0f s inactive)",
+		obs_source_get_name(tf->source), (double)warmup_ns / 1e6,
+		(double)inactive_ns / 1e9);
+	return true;
+}
+
+/**
+  * @brief Wait until the update timer allows the next iteration and there is work to do.
+  *
+  * The thread parks on the condition variable while the filter is inactive or no new frame
+  * was staged since the last one it took, so filters that are not rendered cost no CPU. An
+  * inactive filter that may still unload its model wakes up periodically to check on it, and
+  * one that is shown without a model wakes up to load it.
+  *
+  * @return false if the thread should stop
+*/
+bool wait_for_next_iteration(filter_data *tf, uint64_t next_iteration_ns,
+			     uint64_t last_frame_sequence)
+{
+	std::unique_lock<std::mutex> lock(tf->tesseract_mutex);
+	const uint64_t now_ns = get_time_ns();
+	if (next_iteration_ns > now_ns) {
+		// Sleep for the remaining time as per the update timer
+		tf->tesseract_thread_cv.wait_for(
+			lock, std::chrono::nanoseconds(next_iteration_ns - now_ns),
+			[tf] { return !tf->tesseract_thread_run; });
+	}
+
+	while (tf->tesseract_thread_run) {
+		// announce the wait before checking for a frame, so a frame staged in between
+		// either is seen here or wakes the thread up
+		tf->waitingForFrame = true;
+		if (!tf->isDisabled && tf->inputFrameSequence.load() != last_frame_sequence) {
+			tf->waitingForFrame = false;
+			return true;
+		}
+		if (tf->isDisabled && tf->isShown && !tf->tesseract_model &&
+		    !ocr_memory_over_budget()) {
+			// load the model ahead of activation, once a failed load may be tried
+			// again
+			tf->waitingForFrame = false;
+			const uint64_t retry_ns = tf->modelRetryAtNs.load();
+			const uint64_t wait_now_ns = get_time_ns();
+			if (retry_ns <= wait_now_ns) {
+				return true;
+			}
+			tf->tesseract_thread_cv.wait_for(
+				lock, std::chrono::nanoseconds(retry_ns - wait_now_ns),
+				[tf] { return !tf->tesseract_thread_run; });
+			return tf->tesseract_thread_run;
+		}
+		if (tf->isDisabled && !tf->isShown && tf->tesseract_model &&
+		    (tf->idle_unload_seconds > 0 || ocr_memory_over_budget())) {
+			tf->waitingForFrame = false;
+			tf->tesseract_thread_cv.wait_for(
+				lock, IDLE_CHECK_INTERVAL,
+				[tf] { return !tf->tesseract_thread_run; });
+			return tf->tesseract_thread_run;
+		}
+		tf->tesseract_thread_cv.wait(lock);
+		tf->waitingForFrame = false;
+	}
+	return false;
+}
+
+// Send the boxes, in source pixels, to the image output as a mask or a text overlay
+static void output_detection_boxes(filter_data *tf, const std::vector<OCRBox> &boxes,
+				   cv::Size source_size)
+{
+	cv::Mat text_detection_output(source_size.height, source_size.width, CV_8UC4,
+				      cv::Scalar(0, 0, 0, 0));
+
+	if (tf->output_image_option == OUTPUT_IMAGE_OPTION_DETECTION_MASK) {
+		text_detection_output.setTo(cv::Scalar(0, 0, 0, 255));
+
+		// Create a text detection binary mask
+		for (const auto &box : boxes) {
+			cv::rectangle(text_detection_output, box.box,
+				      cv::Scalar(255, 255, 255, 255), -1);
+		}
+	} else {
+		// Create a text overlay image
+		QImage text_overlay_image = render_boxes_with_qtextdocument(
+			boxes, source_size.width, source_size.height,
+			tf->output_image_option == OUTPUT_IMAGE_OPTION_TEXT_BACKGROUND);
+		cv::Mat text_overlay_image_mat(text_overlay_image.height(),
+					       text_overlay_image.width(), CV_8UC4,
+					       text_overlay_image.bits(),
+					       text_overlay_image.bytesPerLine());
+		text_overlay_image_mat.copyTo(text_detection_output);
+	}
+
+	setTextDetectionMaskCallback(text_detection_output, tf);
+}
+
+static bool redaction_enabled(filter_data *tf)
+{
+	return tf->redactionMode != REDACTION_MODE_OFF && !tf->redactor.empty();
+}
+
+// Boxes stay redacted for the hold time after they were last seen, and at least until the
+// update timer lets OCR see them again
+static uint64_t redaction_hold_ns(filter_data *tf)
+{
+	return ((uint64_t)tf->redactionHoldMs + tf->update_timer_ms) * 1000000ULL;
+}
+
+// Hand the boxes, in source pixels, whose text matches the redactor to the render thread
+static void publish_redaction(filter_data *tf, const std::vector<OCRBox> &boxes,
+			      cv::Size source_size)
+{
+	const std::vector<cv::Rect> matched = tf->redactor.match(boxes);
+	std::lock_guard<std::mutex> lock(tf->redactionLock);
+	tf->redactionBoxes.update(matched, tf->redactionPadding, source_size, os_gettime_ns(),
+				  redaction_hold_ns(tf));
+}
+
+void refresh_redaction(filter_data *tf)
+{
+	std::lock_guard<std::mutex> lock(tf->redactionLock);
+	tf->redactionBoxes.refresh(os_gettime_ns(), redaction_hold_ns(tf));
+}
+
+// Boxes are tracked on every frame of a whole-frame filter when they go to the image output
+// or are redacted
+static bool box_tracking_enabled(filter_data *tf)
+{
+	return tf->trackBoxes && !tf->hasRegions && tf->scrollMode == SCROLL_MODE_OFF &&
+	       (is_valid_output_source_name(tf->output_image_source_name) ||
+		redaction_enabled(tf));
+}
+
+/**
+  * @brief Move the boxes of the last recognition to the frame and send them to the image
+  * output and redaction if they moved.
+  *
+  * @return false if OCR should run again: a box was lost, e.g. because its text changed, or
+  * new content appeared outside the boxes
+*/
+static bool track_boxes(filter_data *tf, const cv::Mat &image, cv::Size source_size)
+{
+	OCR_TRACE_SPAN("track_boxes");
+	cv::Mat gray;
+	to_grayscale(image, gray);
+	const box_tracking_result result =
+		tf->tracker.track(gray, tf->update_on_change_threshold);
+	if (!result.tracked) {
+		// keep the boxes where they were last found until OCR runs
+		tf->tracker.clear();
+		return false;
+	}
+	tf->counters.tracked_frames.fetch_add(1, std::memory_order_relaxed);
+	if (result.moved) {
+		std::vector<OCRBox> boxes = tf->tracker.boxes();
+		scale_boxes(boxes, image.size(), source_size);
+		if (is_valid_output_source_name(tf->output_image_source_name)) {
+			output_detection_boxes(tf, boxes, source_size);
+		}
+		if (redaction_enabled(tf)) {
+			publish_redaction(tf, boxes, source_size);
+		}
+	} else if (redaction_enabled(tf)) {
+		refresh_redaction(tf);
+	}
+	return !result.new_content;
+}
+
 // Tesseract thread function
 void tesseract_thread(void *data)
 {
@@ -300,181 +693,289 @@ void tesseract_thread(void *data)
 	}
 
 	obs_log(LOG_INFO, "Starting Tesseract thread, update timer: %d", tf->update_timer_ms);
+	ocr_trace_set_thread_name("ocr worker " + tf->unique_id);
+	// serve the cv::Mat buffers of this thread from the filter's arena
+	frame_arena_scope arena_scope(tf->arena);
 
 	inja::Environment env;
+	uint64_t last_trace_dump_ns = get_time_ns();
+	uint64_t last_stats_log_ns = get_time_ns();
+	uint64_t last_stats_update_ns = get_time_ns();
+	uint64_t last_frame_sequence = 0;
+	uint64_t inactive_since_ns = 0;
+	uint64_t next_iteration_ns = 0;
+	// box tracking lost the boxes or saw new content since the last recognition
+	bool recognition_needed = true;
+
+	// with box tracking every frame is taken, the update timer only paces OCR
+	while (wait_for_next_iteration(tf, box_tracking_enabled(tf) ? 0 : next_iteration_ns,
+				       last_frame_sequence)) {
+		// time the operation
+		uint64_t request_start_time_ns = get_time_ns();
+		const bool ocr_due = request_start_time_ns >= next_iteration_ns;
+		if (ocr_due) {
+			// pace the iterations as per the update timer, also when a frame is
+			// skipped
+			next_iteration_ns = request_start_time_ns +
+					    (uint64_t)tf->update_timer_ms * 1000000ULL;
+		}
 
-	while (true) {
-		{
-			std::lock_guard<std::mutex> lock(tf->tesseract_mutex);
-			if (!tf->tesseract_thread_run) {
-				break;
-			}
+		// the buffers of the previous iteration are released by now
+		tf->arena.end_iteration();
+		tf->memory.set(OCR_MEMORY_ARENA_POOL, tf->arena.pooled_bytes());
+
+		if (request_start_time_ns - last_stats_update_ns > STATS_UPDATE_INTERVAL_NS) {
+			update_stats_surface(tf);
+			last_stats_update_ns = request_start_time_ns;
+		}
+		if (request_start_time_ns - last_stats_log_ns > STATS_LOG_INTERVAL_NS) {
+			log_filter_stats(tf);
+			last_stats_log_ns = request_start_time_ns;
+		}
+		if (tf->trace_rolling && ocr_trace_enabled() &&
+		    request_start_time_ns - last_trace_dump_ns > TRACE_ROLLING_INTERVAL_NS) {
+			// keep overwriting a per-filter trace file with the most recent spans
+			check_plugin_config_folder_exists();
+			std::string filename = "trace-" + tf->unique_id + ".json";
+			char *trace_path = obs_module_config_path(filename.c_str());
+			ocr_trace_dump(trace_path);
+			bfree(trace_path);
+			last_trace_dump_ns = request_start_time_ns;
 		}
 
-		// time the operation
-		uint64_t request_start_time_ns = get_time_ns();
+		const bool model_loaded = update_model_residency(tf, inactive_since_ns);
 
 		// Send the image to the Tesseract OCR model
 		cv::Mat imageBGRA;
-		{
+		uint64_t frame_timestamp_ns = 0;
+		cv::Size source_size;
+		roi_atlas rois;
+		if (!tf->isDisabled) {
+			OCR_TRACE_SPAN("frame_handoff");
 			std::unique_lock<std::mutex> lock(tf->inputBGRALock, std::try_to_lock);
-			if (lock.owns_lock()) {
-				imageBGRA = tf->inputBGRA.clone();
+			if (!lock.owns_lock()) {
+				tf->counters.handoff_missed.fetch_add(1, std::memory_order_relaxed);
+			} else if (tf->inputFrameSequence.load() != last_frame_sequence) {
+				// take the buffer instead of copying it, the next frame is written
+				// to a new one
+				imageBGRA = tf->inputBGRA;
+				tf->inputBGRAShared = true;
+				frame_timestamp_ns = tf->inputTimestampNs;
+				source_size = tf->inputSourceSize;
+				rois = tf->inputAtlas;
+				last_frame_sequence = tf->inputFrameSequence.load();
+				tf->counters.consumed.fetch_add(1, std::memory_order_relaxed);
 			}
 		}
 
-		if (!imageBGRA.empty()) {
+		if (!imageBGRA.empty() && model_loaded) {
 			try {
 				std::lock_guard<std::mutex> lock(tf->tesseract_settings_mutex);
 
-				// if update on change is true check if the image has changed
-				if (tf->update_on_change &&
-				    imageBGRA.size() == tf->lastInputBGRA.size()) {
-					const int change_threshold_from_image_area =
-						(int)((float)tf->update_on_change_threshold /
-						      100.0f *
-						      (float)(imageBGRA.cols * imageBGRA.rows));
-					// if the image has not changed, skip the processing
-					// take the absolute difference between the images, convert to gray and count the non-zero pixels
-					cv::Mat diff;
-					cv::absdiff(imageBGRA, tf->lastInputBGRA, diff);
-					cv::cvtColor(diff, diff, cv::COLOR_BGRA2GRAY);
-					if (cv::countNonZero(diff) <
-					    change_threshold_from_image_area) {
-						// skip the processing
-						continue;
+				if (tf->recorder) {
+					OCR_TRACE_SPAN("record_frame");
+					// record before change detection so replays see the same
+					// input
+					const std::string segment = tf->recorder->get_path();
+					if (!tf->recorder->write(imageBGRA, frame_timestamp_ns)) {
+						obs_log(LOG_ERROR,
+							"Failed to record frame to %s, stopping "
+							"recording",
+							tf->recorder->get_path().c_str());
+						tf->recorder.reset();
+					} else if (tf->recorder->get_path() != segment) {
+						obs_log(LOG_INFO,
+							"Frame size changed, recording to %s",
+							tf->recorder->get_path().c_str());
 					}
 				}
-				tf->lastInputBGRA = imageBGRA.clone();
-
-				cv::Mat imageForOCR = imageBGRA.clone();
-
-				// if threshold is requested, apply it
-				if (tf->binarizationMode != 0) {
-					cv::Mat gray;
-					cv::cvtColor(imageForOCR, gray, cv::COLOR_BGRA2GRAY);
-
-					if (tf->binarizationMode == 1)
-						cv::threshold(gray, imageForOCR,
-							      tf->binarizationThreshold, 255,
-							      cv::THRESH_BINARY);
-					else if (tf->binarizationMode == 2 ||
-						 tf->binarizationMode == 3) {
-						// ensure that the block size is odd
-						int block_size = tf->binarizationBlockSize;
-						if (tf->binarizationBlockSize % 2 == 0) {
-							block_size++;
-						}
-						if (tf->binarizationMode == 2) {
-							cv::adaptiveThreshold(
-								gray, imageForOCR, 255,
-								cv::ADAPTIVE_THRESH_MEAN_C,
-								cv::THRESH_BINARY, block_size, 2);
-						} else {
-							cv::adaptiveThreshold(
-								gray, imageForOCR, 255,
-								cv::ADAPTIVE_THRESH_GAUSSIAN_C,
-								cv::THRESH_BINARY, block_size, 2);
-						}
-					} else if (tf->binarizationMode == 4)
-						cv::threshold(gray, imageForOCR, 0, 255,
-							      cv::THRESH_BINARY |
-								      cv::THRESH_TRIANGLE);
-					else if (tf->binarizationMode == 5)
-						cv::threshold(gray, imageForOCR, 0, 255,
-							      cv::THRESH_BINARY | cv::THRESH_OTSU);
+
+				if (box_tracking_enabled(tf)) {
+					if (tf->tracker.empty() ||
+					    !track_boxes(tf, imageBGRA, source_size)) {
+						recognition_needed = true;
+					}
+					if (!ocr_due || !recognition_needed) {
+						continue;
+					}
+					recognition_needed = false;
+				} else if (!tf->tracker.empty()) {
+					tf->tracker.clear();
 				}
 
-				if (tf->dilationIterations > 0) {
-					cv::Mat element = cv::getStructuringElement(cv::MORPH_RECT,
-										    cv::Size(3, 3));
-					cv::dilate(imageForOCR, imageForOCR, element,
-						   cv::Point(-1, -1), tf->dilationIterations);
+				// run only the stages the outputs need: the text output needs the
+				// text, the image output and redaction need the boxes, and the
+				// boxes need their text to be drawn as text or to be redacted
+				const bool text_output =
+					is_valid_output_source_name(tf->output_source_name);
+				bool image_output =
+					is_valid_output_source_name(tf->output_image_source_name);
+				bool redaction = redaction_enabled(tf);
+				const bool need_boxes = image_output || redaction;
+				const bool mask_only = tf->output_image_option ==
+						       OUTPUT_IMAGE_OPTION_DETECTION_MASK;
+				const bool recognize =
+					text_output || redaction || (image_output && !mask_only);
+				if (!recognize && !need_boxes && !tf->previewBinarization) {
+					// no output, nothing to run OCR for
+					continue;
 				}
 
-				if (tf->previewBinarization) {
-					// lock the outputPreviewBGRALock
-					std::lock_guard<std::mutex> lock(tf->outputPreviewBGRALock);
-					if (imageForOCR.channels() == 4) {
-						imageForOCR.copyTo(tf->outputPreviewBGRA);
-					} else {
-						cv::cvtColor(imageForOCR, tf->outputPreviewBGRA,
-							     cv::COLOR_GRAY2BGRA);
+				// if update on change is true check if the image has changed
+				if (tf->update_on_change &&
+				    imageBGRA.size() == tf->lastInputBGRA.size() &&
+				    !image_has_changed(imageBGRA, tf->lastInputBGRA,
+						       tf->update_on_change_threshold)) {
+					// skip the processing
+					tf->counters.skipped_unchanged.fetch_add(
+						1, std::memory_order_relaxed);
+					if (redaction_enabled(tf)) {
+						refresh_redaction(tf);
 					}
+					continue;
 				}
-
-				if (tf->rescaleImage) {
-					// scale to height tf->rescaleTargetSize maintaining aspect ratio
-					cv::Mat resized;
-					float scale = (float)tf->rescaleTargetSize /
-						      (float)imageForOCR.rows;
-					cv::resize(imageForOCR, resized, cv::Size(), scale, scale);
-					imageForOCR = resized;
+				if (ocr_memory_over_budget() && imageBGRA.channels() == 4) {
+					// a grayscale reference is a quarter of the size
+					bgra_to_gray(imageBGRA, tf->lastInputBGRA);
+				} else {
+					tf->lastInputBGRA = imageBGRA.clone();
+				}
+				tf->memory.set(OCR_MEMORY_CHANGE_REFERENCE,
+					       mat_bytes(tf->lastInputBGRA));
+
+				if (rois.empty() && tf->hasRegions) {
+					// frames from the CPU paths show the whole source, read the
+					// regions from it in place
+					std::lock_guard<std::mutex> lock(tf->regionsLock);
+					rois = roi_views_in_frame(tf->regions, source_size,
+								  imageBGRA.size());
 				}
 
 				// Process the image
-				std::string ocr_result = run_tesseract_ocr(tf, imageForOCR);
-
-				if (is_valid_output_source_name(tf->output_image_source_name)) {
-					cv::Mat text_detection_output(imageBGRA.rows,
-								      imageBGRA.cols, CV_8UC4,
-								      cv::Scalar(0, 0, 0, 0));
-
-					// Extract the text detection boxes
-					std::vector<OCRBox> boxes =
-						extract_text_detection_boxes(tf, imageBGRA.size());
-
-					if (tf->output_image_option ==
-					    OUTPUT_IMAGE_OPTION_DETECTION_MASK) {
-						text_detection_output.setTo(
-							cv::Scalar(0, 0, 0, 255));
-
-						// Create a text detection binary mask
-						for (const auto &box : boxes) {
-							cv::rectangle(
-								text_detection_output, box.box,
-								cv::Scalar(255, 255, 255, 255), -1);
+				std::string ocr_result;
+				std::vector<OCRBox> boxes;
+				std::vector<std::string> region_texts;
+				if (!rois.empty()) {
+					std::lock_guard<std::mutex> model_lock(
+						tf->tesseract_model->mutex);
+					apply_tesseract_settings(tf->tesseract_model->api,
+								 tf->pageSegmentationMode,
+								 tf->char_whitelist);
+					ocr_result = run_regions_ocr(tf, imageBGRA, rois, recognize,
+								     need_boxes, boxes,
+								     region_texts);
+					tf->memory.set(OCR_MEMORY_PREVIEW, 0);
+					tf->memory.set(OCR_MEMORY_PIPELINE, mat_bytes(imageBGRA));
+				} else if (tf->scrollMode != SCROLL_MODE_OFF) {
+					std::lock_guard<std::mutex> model_lock(
+						tf->tesseract_model->mutex);
+					apply_tesseract_settings(tf->tesseract_model->api,
+								 tf->pageSegmentationMode,
+								 tf->char_whitelist);
+					bool recognized = false;
+					ocr_result = run_scroll_ocr(tf, imageBGRA, need_boxes,
+								    boxes, source_size, recognized);
+					// keep the last boxes while nothing new scrolls in
+					image_output = image_output && recognized;
+					if (redaction && !recognized) {
+						refresh_redaction(tf);
+						redaction = false;
+					}
+					tf->memory.set(OCR_MEMORY_PREVIEW, 0);
+					tf->memory.set(OCR_MEMORY_PIPELINE, mat_bytes(imageBGRA));
+				} else {
+					cv::Mat preview;
+					cv::Mat imageForOCR = preprocess_image(
+						imageBGRA, get_pipeline_settings(tf),
+						tf->previewBinarization ? &preview : nullptr);
+
+					if (tf->previewBinarization) {
+						// lock the outputPreviewLock
+						std::lock_guard<std::mutex> lock(
+							tf->outputPreviewLock);
+						tf->outputPreview = preview;
+						tf->outputPreviewSequence++;
+					}
+					// the preview shares a pipeline buffer unless the image was
+					// rescaled after it
+					const bool preview_shared =
+						preview.data == imageBGRA.data ||
+						preview.data == imageForOCR.data;
+					tf->memory.set(OCR_MEMORY_PREVIEW,
+						       preview_shared ? 0 : mat_bytes(preview));
+					tf->memory.set(OCR_MEMORY_PIPELINE,
+						       mat_bytes(imageBGRA) +
+							       mat_bytes(imageForOCR));
+
+					{
+						// the model may be shared with other filters, use
+						// it with this filter's settings
+						std::lock_guard<std::mutex> model_lock(
+							tf->tesseract_model->mutex);
+						apply_tesseract_settings(
+							tf->tesseract_model->api,
+							tf->pageSegmentationMode,
+							tf->char_whitelist);
+						if (recognize) {
+							ocr_result =
+								run_tesseract_ocr(tf, imageForOCR);
+						}
+						if (need_boxes) {
+							// Extract the text detection boxes
+							boxes = find_text_boxes(tf, imageForOCR,
+										recognize);
 						}
-					} else {
-						// Create a text overlay image
-						QImage text_overlay_image = render_boxes_with_qtextdocument(
-							boxes, imageBGRA.cols, imageBGRA.rows,
-							tf->output_image_option ==
-								OUTPUT_IMAGE_OPTION_TEXT_BACKGROUND);
-						cv::Mat text_overlay_image_mat(
-							text_overlay_image.height(),
-							text_overlay_image.width(), CV_8UC4,
-							text_overlay_image.bits(),
-							text_overlay_image.bytesPerLine());
-						text_overlay_image_mat.copyTo(
-							text_detection_output);
 					}
+					// the boxes are found in the rescaled image, the image
+					// output has the size of the source
+					scale_boxes(boxes, imageForOCR.size(), source_size);
+					if (box_tracking_enabled(tf)) {
+						// track the boxes in the frame from now on
+						std::vector<OCRBox> frame_boxes = boxes;
+						scale_boxes(frame_boxes, source_size,
+							    imageBGRA.size());
+						cv::Mat gray;
+						to_grayscale(imageBGRA, gray);
+						tf->tracker.reset(gray, frame_boxes);
+					}
+				}
 
-					setTextDetectionMaskCallback(text_detection_output, tf);
+				OCR_TRACE_SPAN("output");
+				// the frame time can be slightly ahead of the clock while rendering
+				auto latency_since_capture_ns = [frame_timestamp_ns]() {
+					const uint64_t now_ns = os_gettime_ns();
+					return now_ns > frame_timestamp_ns
+						       ? now_ns - frame_timestamp_ns
+						       : 0;
+				};
+				bool output_updated = false;
+				if (image_output) {
+					output_detection_boxes(tf, boxes, source_size);
+					output_updated = true;
+				}
+				if (redaction) {
+					publish_redaction(tf, boxes, source_size);
 				}
 
 				if (!ocr_result.empty() &&
 				    is_valid_output_source_name(tf->output_source_name)) {
 					// If an output source is selected - send the results there
-					ocr_result = format_text_with_template(env, ocr_result, tf);
-					setTextCallback(ocr_result, tf);
+					const uint64_t latency_ms =
+						latency_since_capture_ns() / 1000000;
+					ocr_result = format_text_with_template(
+						env, ocr_result, tf, latency_ms, region_texts);
+					setTextCallback(ocr_result, tf, (int64_t)latency_ms);
+					output_updated = true;
+				}
+
+				if (output_updated) {
+					tf->capture_to_output_latency.record(
+						latency_since_capture_ns());
 				}
 			} catch (const std::exception &e) {
 				obs_log(LOG_ERROR, "%s", e.what());
 			}
 		}
-
-		// time the request, calculate the remaining time and sleep
-		const uint64_t request_end_time_ns = get_time_ns();
-		const uint64_t request_time_ns = request_end_time_ns - request_start_time_ns;
-		const int64_t sleep_time_ms =
-			(int64_t)(tf->update_timer_ms) - (int64_t)(request_time_ns / 1000000);
-		if (sleep_time_ms > 0) {
-			std::unique_lock<std::mutex> lock(tf->tesseract_mutex);
-			// Sleep for n ns as per the update timer for the remaining time
-			tf->tesseract_thread_cv.wait_for(lock,
-							 std::chrono::milliseconds(sleep_time_ms));
-		}
 	}
 	obs_log(LOG_INFO, "Stopping Tesseract thread");
 
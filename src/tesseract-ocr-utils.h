@@ -2,33 +2,20 @@
 #define TESSERACT_OCR_UTILS_H
 
 #include "filter-data.h"
+#include "ocr-pipeline.h"
 
-#include <deque>
 #include <string>
 
-struct OCRBox {
-	std::string text;
-	cv::Rect box;
-};
-
 void cleanup_config_files(const std::string &unique_id);
 void initialize_tesseract_ocr(filter_data *tf, bool hard_tesseract_init_required = false);
+ocr_pipeline_settings get_pipeline_settings(filter_data *tf);
 std::string run_tesseract_ocr(filter_data *tf, const cv::Mat &imageBGRA);
-std::vector<OCRBox> extract_text_detection_boxes(filter_data *tf);
-std::string strip(const std::string &str);
+std::vector<OCRBox> extract_text_detection_boxes(filter_data *tf, cv::Size imageSize);
+void log_filter_stats(filter_data *tf);
+// The redacted text is still where it was, e.g. the frame did not change: keep it redacted
+void refresh_redaction(filter_data *tf);
+void wake_tesseract_thread(filter_data *tf);
 void stop_and_join_tesseract_thread(struct filter_data *tf);
 void tesseract_thread(void *data);
 
-class CharacterBasedSmoothingFilter {
-public:
-	CharacterBasedSmoothingFilter(size_t word_length, size_t window_size = 10);
-
-	std::string add_reading(const std::string &word);
-
-private:
-	size_t word_length;
-	size_t window_size;
-	std::vector<std::deque<char>> readings;
-};
-
 #endif /* TESSERACT_OCR_UTILS_H */